@@ -1,24 +1,12 @@
-QT       += core gui
-
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
-
-CONFIG += c++17
-
-# You can make your code fail to compile if it uses deprecated APIs.
-# In order to do so, uncomment the following line.
-#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
-
-SOURCES += \
-    main.cpp \
-    mainwindow.cpp
-
-HEADERS += \
-    mainwindow.h
-
-FORMS += \
-    mainwindow.ui
-
-# Default rules for deployment.
-qnx: target.path = /tmp/$${TARGET}/bin
-else: unix:!android: target.path = /opt/$${TARGET}/bin
-!isEmpty(target.path): INSTALLS += target
+# The game, its benchmarks and the end-to-end harness. All build the shared
+# sources listed in core.pri, so they measure exactly the code the game runs.
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    app \
+    benchmarks \
+    endtoend
+
+app.file = app.pro
+benchmarks.file = benchmarks/benchmarks.pro
+endtoend.file = endtoend/endtoend.pro
@@ -0,0 +1,110 @@
+#include "alloccount.h"
+
+#ifdef SNAKE_ALLOC_COUNT
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Read and bumped from inside malloc, so it must never allocate itself: a
+// plain TLS slot in the executable
+#if defined(__GNUC__)
+__attribute__((tls_model("initial-exec")))
+#endif
+thread_local uint64_t count = 0;
+
+} // namespace
+
+uint64_t AllocCount::allocations() {
+    return count;
+}
+
+#if defined(__GLIBC__)
+
+// glibc: the malloc family itself is replaced, forwarding to glibc's own
+// entry points. That sees Qt's containers, which allocate with malloc and
+// realloc, and operator new, which libstdc++ builds on malloc.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+
+void* malloc(size_t size) {
+    ++count;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+    ++count;
+    return __libc_calloc(n, size);
+}
+
+// Counted even when the block grows in place; a tick should not be resizing anything
+void* realloc(void* p, size_t size) {
+    ++count;
+    return __libc_realloc(p, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    ++count;
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    ++count;
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** p, size_t alignment, size_t size) {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+        return 22; // EINVAL
+    ++count;
+    *p = __libc_memalign(alignment, size);
+    return *p || size == 0 ? 0 : 12; // ENOMEM
+}
+}
+
+#else
+
+// Elsewhere only operator new is replaced, so Qt's containers, which
+// allocate with malloc, go unseen
+namespace {
+
+void* allocate(std::size_t size) {
+    ++count;
+    void* p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* allocate(std::size_t size, const std::nothrow_t&) noexcept {
+    ++count;
+    return std::malloc(size ? size : 1);
+}
+
+} // namespace
+
+// The aligned forms are left alone; nothing in the game uses over-aligned types
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t& tag) noexcept { return allocate(size, tag); }
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept { return allocate(size, tag); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+#endif // __GLIBC__
+
+#else
+
+uint64_t AllocCount::allocations() {
+    return 0;
+}
+
+#endif // SNAKE_ALLOC_COUNT
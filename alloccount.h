@@ -0,0 +1,29 @@
+#ifndef ALLOCCOUNT_H
+#define ALLOCCOUNT_H
+
+#include <cstdint>
+
+// Heap allocation counting for the hot path. With SNAKE_ALLOC_COUNT (qmake
+// CONFIG+=alloccount) every allocation is counted on the calling thread, so
+// a tick can be checked by reading the count before and after it. Worker
+// threads keep their own counts and never show up in the GUI thread's.
+//
+// On glibc malloc, calloc, realloc and the aligned forms are replaced, which
+// covers Qt's containers (QString, QList, QImage...) as well as operator
+// new. Elsewhere only operator new is replaced and Qt's allocations go
+// unseen.
+//
+// Without SNAKE_ALLOC_COUNT nothing is replaced and allocations() is 0.
+namespace AllocCount {
+
+#ifdef SNAKE_ALLOC_COUNT
+constexpr bool Enabled = true;
+#else
+constexpr bool Enabled = false;
+#endif
+
+uint64_t allocations(); // by this thread so far
+
+} // namespace AllocCount
+
+#endif // ALLOCCOUNT_H
@@ -0,0 +1,275 @@
+#include "arena.h"
+#include "trace.h"
+#include <algorithm>
+
+ArenaEngine::ArenaEngine(const ArenaConfig& config)
+{
+    reset(config);
+}
+
+void ArenaEngine::reset(const ArenaConfig& config) {
+    cfg = config;
+    rng.reseed(cfg.seed);
+    cols = 2 * cfg.halfCols;
+    rowCount = 2 * cfg.halfRows;
+    ticks = 0;
+    grid.assign(static_cast<size_t>(cols) * rowCount, CellKind::Empty);
+    players.clear();
+    turns.clear();
+    foodCells.clear();
+    foodTimers.clear();
+    bombCells.clear();
+    cooling = 0;
+    timers.reset();
+    events.clear();
+    published = false;
+    claimed.assign(grid.size(), 0);
+    claimant.assign(grid.size(), -1);
+    leaving.assign(grid.size(), 0);
+
+    // Walls are laid out as GameEngine::stampLevel does: centred, top row first
+    if (cfg.level) {
+        const Level& level = *cfg.level;
+        const int left = -level.cols / 2;
+        const int top = level.rows / 2 - 1;
+        for (int row = 0; row < level.rows; ++row) {
+            const int y = top - row;
+            for (int col = 0; col < level.cols; ++col) {
+                const int x = left + col;
+                if (level.wallAt(col, row) && x >= -cfg.halfCols && x < cfg.halfCols && y >= -cfg.halfRows
+                    && y < cfg.halfRows)
+                    set({ x, y }, CellKind::Wall);
+            }
+        }
+    }
+}
+
+// Events already handed out by step() are dropped before anything new is added
+void ArenaEngine::beginEvents() {
+    if (!published)
+        return;
+    events.clear();
+    published = false;
+}
+
+// Rejection sampling: the arena board is mostly free, and keeping a
+// free-cell set in step with dozens of snakes would cost more than it saves
+bool ArenaEngine::randomFree(Cell& out) {
+    for (int attempt = 0; attempt < 64; ++attempt) {
+        const int i = static_cast<int>(rng.bounded(static_cast<uint32_t>(grid.size())));
+        if (grid[i] == CellKind::Empty) {
+            out = { i % cols - cfg.halfCols, i / cols - cfg.halfRows };
+            return true;
+        }
+    }
+    return false;
+}
+
+void ArenaEngine::spawn(CellKind kind, Cell c) {
+    set(c, kind);
+    ArenaEvent event;
+    event.kind = ArenaEventKind::Spawn;
+    event.what = kind;
+    event.cell = c;
+    events.push_back(event);
+}
+
+void ArenaEngine::clear(Cell c) {
+    set(c, CellKind::Empty);
+    ArenaEvent event;
+    event.kind = ArenaEventKind::Clear;
+    event.cell = c;
+    events.push_back(event);
+}
+
+void ArenaEngine::placeFood(Cell c, int64_t nowMs) {
+    foodCells.push_back(c);
+    foodTimers.push_back(scheduleFoodExpiry(timers, cfg, c, nowMs));
+    spawn(CellKind::Food, c);
+}
+
+int ArenaEngine::join() {
+    beginEvents();
+    for (int attempt = 0; attempt < 64; ++attempt) {
+        Cell head;
+        if (!randomFree(head))
+            return -1;
+        bool free = true;
+        for (int i = 1; i < JoinLength && free; ++i)
+            free = cellAt(wrapped({ head.x - i, head.y }, cfg.halfCols, cfg.halfRows)) == CellKind::Empty;
+        if (!free)
+            continue;
+
+        int id = 0;
+        while (id < static_cast<int>(players.size()) && players[id].alive)
+            ++id;
+        if (id == static_cast<int>(players.size())) {
+            players.emplace_back();
+            turns.push_back(Direction::None);
+            fate.push_back(0);
+            nextHeads.emplace_back();
+        }
+        ArenaSnake& snake = players[id];
+        snake.alive = true;
+        snake.heading = Direction::Right;
+        snake.score = 0;
+        snake.body.clear();
+        for (int i = JoinLength - 1; i >= 0; --i) {
+            const Cell c = wrapped({ head.x - i, head.y }, cfg.halfCols, cfg.halfRows);
+            snake.body.push_back(c);
+            set(c, CellKind::Snake);
+        }
+        turns[id] = Direction::None;
+
+        ArenaEvent event;
+        event.kind = ArenaEventKind::Join;
+        event.snake = id;
+        event.direction = Direction::Right;
+        event.cell = head;
+        events.push_back(event);
+        return id;
+    }
+    return -1;
+}
+
+void ArenaEngine::kill(int snake) {
+    ArenaSnake& dead = players[snake];
+    for (const Cell& c : dead.body)
+        set(c, CellKind::Empty);
+    dead.body.clear();
+    dead.alive = false;
+    dead.heading = Direction::None;
+    ArenaEvent event;
+    event.kind = ArenaEventKind::Death;
+    event.snake = snake;
+    events.push_back(event);
+}
+
+void ArenaEngine::leave(int snake) {
+    beginEvents();
+    if (snake >= 0 && snake < static_cast<int>(players.size()) && players[snake].alive)
+        kill(snake);
+}
+
+void ArenaEngine::turn(int snake, Direction direction) {
+    if (snake >= 0 && snake < static_cast<int>(players.size()))
+        turns[snake] = direction;
+}
+
+const std::vector<ArenaEvent>& ArenaEngine::step(int64_t nowMs) {
+    TRACE_SCOPE("ArenaEngine::step");
+    beginEvents();
+    published = true;
+    const uint32_t stamp = ++ticks;
+    const int count = static_cast<int>(players.size());
+
+    Cell c;
+    while (static_cast<int>(foodCells.size()) < cfg.foods && randomFree(c))
+        placeFood(c, nowMs);
+    if (rollBomb(cfg, bombCells.size(), cooling, rng) && randomFree(c)) {
+        bombCells.push_back(c);
+        spawn(CellKind::Bomb, c);
+        scheduleFuse(timers, cfg, c, nowMs);
+    }
+
+    // Where every head goes, and which tails leave to make room
+    for (int i = 0; i < count; ++i) {
+        ArenaSnake& snake = players[i];
+        if (!snake.alive)
+            continue;
+        if (turns[i] != Direction::None && !isReversal(turns[i], snake.heading))
+            snake.heading = turns[i];
+        turns[i] = Direction::None;
+        const Cell head = snake.body.back();
+        nextHeads[i] = wrapped({ head.x + directionX(snake.heading), head.y + directionY(snake.heading) }, cfg.halfCols,
+                               cfg.halfRows);
+        fate[i] = cellAt(nextHeads[i]) == CellKind::Food ? 1 : 0;
+        if (!fate[i])
+            leaving[index(snake.body.front())] = stamp;
+    }
+
+    // Collisions are judged against the board as it stood, so the outcome
+    // does not depend on the order snakes are listed in
+    for (int i = 0; i < count; ++i) {
+        if (!players[i].alive)
+            continue;
+        const int cell = index(nextHeads[i]);
+        const CellKind target = grid[cell];
+        if (isObstacle(target) && leaving[cell] != stamp)
+            fate[i] = 2;
+        if (claimed[cell] == stamp) {
+            fate[i] = 2;
+            fate[claimant[cell]] = 2;
+        }
+        claimed[cell] = stamp;
+        claimant[cell] = i;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (players[i].alive && fate[i] == 2)
+            kill(i);
+    }
+    for (int i = 0; i < count; ++i) {
+        ArenaSnake& snake = players[i];
+        if (!snake.alive || fate[i] == 1)
+            continue;
+        const Cell tail = snake.body.front();
+        snake.body.pop_front();
+        set(tail, CellKind::Empty);
+    }
+    for (int i = 0; i < count; ++i) {
+        ArenaSnake& snake = players[i];
+        if (!snake.alive)
+            continue;
+        const Cell next = nextHeads[i];
+        if (fate[i] == 1) {
+            snake.score += 1;
+            const size_t eaten = static_cast<size_t>(std::find(foodCells.begin(), foodCells.end(), next) - foodCells.begin());
+            timers.cancel(foodTimers[eaten]);
+            foodCells.erase(foodCells.begin() + eaten);
+            foodTimers.erase(foodTimers.begin() + eaten);
+        }
+        snake.body.push_back(next);
+        set(next, CellKind::Snake);
+        ArenaEvent event;
+        event.kind = fate[i] == 1 ? ArenaEventKind::Grow : ArenaEventKind::Move;
+        event.snake = i;
+        event.direction = snake.heading;
+        events.push_back(event);
+    }
+
+    while (static_cast<int>(foodCells.size()) < cfg.foods && randomFree(c))
+        placeFood(c, nowMs);
+
+    timers.advance(nowMs, [this, nowMs](int64_t, const GameTimer& timer) { expire(timer, nowMs); });
+    return events;
+}
+
+// Bombs and food come and go as in GameEngine::expire
+void ArenaEngine::expire(const GameTimer& timer, int64_t nowMs) {
+    switch (timer.event) {
+    case TimedEvent::BombDiffuse:
+        bombCells.erase(std::find(bombCells.begin(), bombCells.end(), timer.cell));
+        clear(timer.cell);
+        ++cooling;
+        scheduleCooldown(timers, cfg, timer);
+        break;
+    case TimedEvent::BombCooldownEnd:
+        --cooling;
+        break;
+    case TimedEvent::FoodExpire: {
+        // The new food is drawn before the old cell frees up, so it moves
+        const size_t food = static_cast<size_t>(std::find(foodCells.begin(), foodCells.end(), timer.cell) - foodCells.begin());
+        Cell c;
+        if (food < foodCells.size() && randomFree(c)) {
+            foodCells[food] = c;
+            foodTimers[food] = scheduleFoodExpiry(timers, cfg, c, nowMs);
+            spawn(CellKind::Food, c);
+            clear(timer.cell);
+        }
+        break;
+    }
+    default:
+        break; // no notices or power-ups in the arena
+    }
+}
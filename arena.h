@@ -0,0 +1,111 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "gameengine.h"
+#include "gametypes.h"
+#include "rng.h"
+#include "timerwheel.h"
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// The single-player board and bomb and food rules, shared by everyone.
+// Power-ups are not played in the arena.
+struct ArenaConfig : GameConfig {
+    int foods = 8;                // food kept on the board at all times, space permitting
+};
+
+// What changed on the board in one tick, in the order it happened. This is
+// all a client needs to follow the game once it has a keyframe.
+enum class ArenaEventKind : uint8_t {
+    Move,   // head one cell on in direction, tail cell freed
+    Grow,   // head one cell on in direction, tail kept (ate food)
+    Death,  // every cell of the snake freed
+    Join,   // a new snake, body in cells
+    Spawn,  // food or bomb appeared at cell
+    Clear,  // food or bomb at cell went away (a fuse ran out, or the food moved)
+};
+
+struct ArenaEvent {
+    ArenaEventKind kind = ArenaEventKind::Move;
+    int snake = -1;
+    Direction direction = Direction::None;
+    CellKind what = CellKind::Empty; // for Spawn
+    Cell cell;                       // for Spawn and Clear
+};
+
+struct ArenaSnake {
+    bool alive = false;
+    Direction heading = Direction::None;
+    int score = 0;
+    std::deque<Cell> body; // tail first
+};
+
+// The single-player rules of GameEngine::step for any number of snakes on
+// one board; the wrap, the obstacles and the bomb and food timings come from
+// the same helpers. Everyone moves at once: a head may take a cell another
+// tail leaves in the same tick, two heads meeting in one cell both die, and
+// a dead snake is taken off the board straight away. Snakes join and leave
+// between ticks; the events say what changed.
+class ArenaEngine
+{
+public:
+    static const int JoinLength = 3;      // a new snake is a straight line behind its head
+
+    explicit ArenaEngine(const ArenaConfig& config = ArenaConfig());
+
+    void reset(const ArenaConfig& config);
+    int join();                           // new snake id, or -1 if there is no room
+    void leave(int snake);
+    void turn(int snake, Direction direction); // applied on the next step
+    const std::vector<ArenaEvent>& step(int64_t nowMs);
+
+    // The last step's events, after any joins and leaves that came before it
+    const std::vector<ArenaEvent>& changes() const { return events; }
+
+    const ArenaConfig& config() const { return cfg; }
+    int columns() const { return cols; }
+    int rows() const { return rowCount; }
+    uint32_t tick() const { return ticks; }
+    const std::vector<ArenaSnake>& snakes() const { return players; }
+    const std::vector<Cell>& foods() const { return foodCells; }
+    const std::vector<Cell>& bombs() const { return bombCells; }
+    CellKind cellAt(Cell c) const { return grid[index(c)]; }
+    const CellKind* cells() const { return grid.data(); } // row-major, bottom row first
+
+private:
+    int index(Cell c) const { return (c.y + cfg.halfRows) * cols + (c.x + cfg.halfCols); }
+    void set(Cell c, CellKind kind) { grid[index(c)] = kind; }
+    void beginEvents();
+    bool randomFree(Cell& out);
+    void spawn(CellKind kind, Cell c);
+    void clear(Cell c);
+    void placeFood(Cell c, int64_t nowMs);
+    void kill(int snake);
+    void expire(const GameTimer& timer, int64_t nowMs);
+
+    ArenaConfig cfg;
+    Rng rng;
+    int cols = 0;
+    int rowCount = 0;
+    uint32_t ticks = 0;
+    std::vector<CellKind> grid;
+    std::vector<ArenaSnake> players; // by id; dead slots are reused by join()
+    std::vector<Direction> turns;    // requested for the next step, by id
+    std::vector<Cell> foodCells;
+    std::vector<TimerId> foodTimers; // by food, when it moves on
+    std::vector<Cell> bombCells;     // in the order they were planted
+    int cooling = 0;                 // bombs diffused and still cooling down
+    TimerWheel<GameTimer> timers;
+    std::vector<ArenaEvent> events;
+    bool published = false;          // events went out with a step; the next change starts afresh
+
+    // Per-step scratch, kept to avoid reallocating
+    std::vector<Cell> nextHeads;
+    std::vector<uint8_t> fate;       // by id: 0 moves, 1 grows, 2 dies
+    std::vector<uint32_t> claimed;   // by cell: step stamp of a head moving in
+    std::vector<int> claimant;       // by cell: the snake whose head that is
+    std::vector<uint32_t> leaving;   // by cell: step stamp of a tail moving out
+};
+
+#endif // ARENA_H
@@ -0,0 +1,89 @@
+#include "arenaclient.h"
+#include "varint.h"
+#include <QHostAddress>
+#include <QLocalSocket>
+#include <QTcpSocket>
+
+ArenaClient::ArenaClient(Role role, uint64_t seed, QObject* parent)
+    : QObject(parent)
+    , role(role)
+    , rng(seed)
+{
+}
+
+void ArenaClient::connectTcp(quint16 port) {
+    QTcpSocket* tcp = new QTcpSocket(this);
+    tcp->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    connect(tcp, &QTcpSocket::disconnected, this, [this] { broken = true; });
+    connect(tcp, &QTcpSocket::errorOccurred, this, [this] { broken = true; });
+    attach(tcp);
+    tcp->connectToHost(QHostAddress::LocalHost, port);
+}
+
+void ArenaClient::connectLocal(const QString& name) {
+    QLocalSocket* local = new QLocalSocket(this);
+    connect(local, &QLocalSocket::disconnected, this, [this] { broken = true; });
+    connect(local, &QLocalSocket::errorOccurred, this, [this] { broken = true; });
+    attach(local);
+    local->connectToServer(name);
+}
+
+void ArenaClient::attach(QIODevice* device) {
+    socket = device;
+    connect(socket, &QIODevice::readyRead, this, &ArenaClient::readServer);
+}
+
+void ArenaClient::send(const std::string& data) {
+    socket->write(data.data(), static_cast<qint64>(data.size()));
+}
+
+void ArenaClient::readServer() {
+    const QByteArray data = socket->readAll();
+    received += data.size();
+    framer.feed(data.constData(), static_cast<size_t>(data.size()));
+    std::string payload;
+    while (!broken && framer.next(payload)) {
+        if (payload[0] == static_cast<char>(ArenaMessage::Welcome)) {
+            VarintReader in = { reinterpret_cast<const uint8_t*>(payload.data()) + 1,
+                                reinterpret_cast<const uint8_t*>(payload.data()) + payload.size() };
+            own = static_cast<int>(in.signedVarint());
+            joining = false;
+            welcomeTick = mirror.tick();
+            continue;
+        }
+        const bool tick = payload[0] == static_cast<char>(ArenaMessage::Tick);
+        if (!mirror.apply(payload)) {
+            broken = true;
+            socket->close();
+            return;
+        }
+        if (tick)
+            onTick();
+    }
+    broken = broken || framer.failed();
+}
+
+// A bot answers every tick: a turn if it wants one, or a Join when it has no
+// snake. The snake it was given appears with the tick after the Welcome;
+// once that is applied, no living snake means it died, even on that tick.
+void ArenaClient::onTick() {
+    emit updated();
+    if (role != Role::Bot)
+        return;
+
+    const std::vector<ArenaMirrorSnake>& snakes = mirror.snakes();
+    const bool alive = own >= 0 && own < static_cast<int>(snakes.size()) && snakes[own].alive;
+    if (alive) {
+        const Direction turn = arenaBotTurn(mirror, own, rng);
+        if (turn != snakes[own].heading)
+            send(encodeArenaTurn(turn));
+        return;
+    }
+    if (own >= 0 && mirror.tick() <= welcomeTick)
+        return;
+    if (!joining) {
+        own = -1;
+        joining = true;
+        send(encodeArenaJoin());
+    }
+}
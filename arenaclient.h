@@ -0,0 +1,54 @@
+#ifndef ARENACLIENT_H
+#define ARENACLIENT_H
+
+#include "arenaprotocol.h"
+#include "rng.h"
+#include <QObject>
+#include <QString>
+
+class QIODevice;
+
+// One connection to an ArenaServer, keeping an ArenaMirror of the board. A
+// spectator only watches; a bot joins, steers with arenaBotTurn every tick
+// and joins again whenever its snake dies.
+class ArenaClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Role { Spectator, Bot };
+
+    ArenaClient(Role role, uint64_t seed, QObject* parent = nullptr);
+
+    void connectTcp(quint16 port);             // to the loopback server
+    void connectLocal(const QString& name);
+
+    const ArenaMirror& board() const { return mirror; }
+    bool failed() const { return broken; }     // the stream did not decode, or the server went away
+    int64_t receivedBytes() const { return received; }
+    int snake() const { return own; }
+
+signals:
+    void updated();                            // a tick was applied
+
+private slots:
+    void readServer();
+
+private:
+    void attach(QIODevice* device);
+    void onTick();
+    void send(const std::string& data);
+
+    Role role;
+    Rng rng;
+    QIODevice* socket = nullptr;
+    ArenaFramer framer;
+    ArenaMirror mirror;
+    int64_t received = 0;
+    bool broken = false;
+    int own = -1;              // our snake, once the server has said which
+    bool joining = false;      // Join sent, Welcome not back yet
+    uint32_t welcomeTick = 0;  // the mirror's tick when the Welcome came; the next one carries the Join
+};
+
+#endif // ARENACLIENT_H
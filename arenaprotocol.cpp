@@ -0,0 +1,373 @@
+#include "arenaprotocol.h"
+#include "varint.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// Event codes in the low four bits of a Tick tag
+const uint64_t MoveCode = 0;   // + direction - 1
+const uint64_t GrowCode = 4;   // + direction - 1
+const uint64_t DeathCode = 8;
+const uint64_t JoinCode = 9;   // operand: head index << 2 | direction - 1
+const uint64_t SpawnCode = 10; // operand: index << 3 | kind
+const uint64_t ClearCode = 11; // operand: index
+
+const Direction Directions[4] = { Direction::Right, Direction::Left, Direction::Up, Direction::Down };
+
+// Payloads go out behind their length
+std::string framed(const std::string& payload) {
+    std::string out;
+    out.reserve(payload.size() + 3);
+    putVarint(out, payload.size());
+    out += payload;
+    return out;
+}
+
+} // namespace
+
+std::string encodeArenaKeyframe(const ArenaEngine& arena) {
+    const ArenaConfig& config = arena.config();
+    const int cellCount = arena.columns() * arena.rows();
+    std::string out(1, static_cast<char>(ArenaMessage::Keyframe));
+    putVarint(out, static_cast<uint64_t>(config.halfCols));
+    putVarint(out, static_cast<uint64_t>(config.halfRows));
+    putVarint(out, arena.tick());
+
+    // The board in runs of one kind
+    const CellKind* cells = arena.cells();
+    for (int i = 0; i < cellCount;) {
+        int end = i + 1;
+        while (end < cellCount && cells[end] == cells[i])
+            ++end;
+        putVarint(out, static_cast<uint64_t>(end - i) << 3 | static_cast<uint64_t>(cells[i]));
+        i = end;
+    }
+
+    // Snakes, so clients know which end of each is the tail
+    const std::vector<ArenaSnake>& snakes = arena.snakes();
+    putVarint(out, snakes.size());
+    for (const ArenaSnake& snake : snakes) {
+        putVarint(out, snake.alive ? snake.body.size() : 0);
+        if (!snake.alive)
+            continue;
+        putVarint(out, static_cast<uint64_t>(snake.heading));
+        putVarint(out, static_cast<uint64_t>(snake.score));
+        const Cell tail = snake.body.front();
+        putVarint(out, static_cast<uint64_t>((tail.y + config.halfRows) * arena.columns() + tail.x + config.halfCols));
+        uint8_t packed = 0;
+        for (size_t i = 1; i < snake.body.size(); ++i) {
+            const int code = static_cast<int>(stepDirection(snake.body[i - 1], snake.body[i])) - 1;
+            packed |= static_cast<uint8_t>(code << ((i - 1) % 4 * 2));
+            if ((i - 1) % 4 == 3 || i + 1 == snake.body.size()) {
+                out += static_cast<char>(packed);
+                packed = 0;
+            }
+        }
+    }
+    return framed(out);
+}
+
+std::string encodeArenaTick(const ArenaEngine& arena) {
+    const ArenaConfig& config = arena.config();
+    auto indexOf = [&](Cell c) {
+        return static_cast<uint64_t>((c.y + config.halfRows) * arena.columns() + c.x + config.halfCols);
+    };
+
+    const std::vector<ArenaEvent>& events = arena.changes();
+    std::string out(1, static_cast<char>(ArenaMessage::Tick));
+    putVarint(out, arena.tick());
+    putVarint(out, events.size());
+    for (const ArenaEvent& event : events) {
+        const uint64_t snake = event.snake < 0 ? 0 : static_cast<uint64_t>(event.snake) << 4;
+        const uint64_t direction = event.direction == Direction::None ? 0 : static_cast<uint64_t>(event.direction) - 1;
+        switch (event.kind) {
+        case ArenaEventKind::Move:
+            putVarint(out, snake | (MoveCode + direction));
+            break;
+        case ArenaEventKind::Grow:
+            putVarint(out, snake | (GrowCode + direction));
+            break;
+        case ArenaEventKind::Death:
+            putVarint(out, snake | DeathCode);
+            break;
+        case ArenaEventKind::Join:
+            putVarint(out, snake | JoinCode);
+            putVarint(out, indexOf(event.cell) << 2 | direction);
+            break;
+        case ArenaEventKind::Spawn:
+            putVarint(out, SpawnCode);
+            putVarint(out, indexOf(event.cell) << 3 | static_cast<uint64_t>(event.what));
+            break;
+        case ArenaEventKind::Clear:
+            putVarint(out, ClearCode);
+            putVarint(out, indexOf(event.cell));
+            break;
+        }
+    }
+    return framed(out);
+}
+
+std::string encodeArenaWelcome(int snake) {
+    std::string out(1, static_cast<char>(ArenaMessage::Welcome));
+    putSigned(out, snake);
+    return framed(out);
+}
+
+std::string encodeArenaJoin() {
+    return framed(std::string(1, static_cast<char>(ArenaMessage::Join)));
+}
+
+std::string encodeArenaTurn(Direction direction) {
+    std::string out(1, static_cast<char>(ArenaMessage::Turn));
+    out += static_cast<char>(direction);
+    return framed(out);
+}
+
+void ArenaFramer::feed(const char* data, size_t size) {
+    // Drop what has been consumed before the buffer grows again
+    if (offset > 0 && offset * 2 >= buffer.size()) {
+        buffer.erase(0, offset);
+        offset = 0;
+    }
+    buffer.append(data, size);
+}
+
+bool ArenaFramer::next(std::string& payload) {
+    if (broken)
+        return false;
+    VarintReader in = { reinterpret_cast<const uint8_t*>(buffer.data()) + offset,
+                        reinterpret_cast<const uint8_t*>(buffer.data()) + buffer.size() };
+    const uint64_t size = in.varint();
+    if (!in.ok) {
+        broken = buffer.size() - offset >= 10; // a varint never runs that long
+        return false;
+    }
+    if (size == 0 || size > (64u << 20)) {
+        broken = true;
+        return false;
+    }
+    if (size > static_cast<uint64_t>(in.end - in.p))
+        return false;
+    payload.assign(reinterpret_cast<const char*>(in.p), static_cast<size_t>(size));
+    offset = static_cast<size_t>(in.p - reinterpret_cast<const uint8_t*>(buffer.data())) + static_cast<size_t>(size);
+    return true;
+}
+
+ArenaMirrorSnake* ArenaMirror::snake(uint64_t id, bool create) {
+    if (id >= players.size()) {
+        if (!create || id > players.size() + 4096)
+            return nullptr;
+        players.resize(static_cast<size_t>(id) + 1);
+    }
+    return &players[static_cast<size_t>(id)];
+}
+
+void ArenaMirror::set(Cell c, CellKind kind) {
+    CellKind& cell = grid[index(c)];
+    if (cell == CellKind::Food && kind != CellKind::Food)
+        foodCells.erase(std::find(foodCells.begin(), foodCells.end(), c));
+    else if (kind == CellKind::Food && cell != CellKind::Food)
+        foodCells.push_back(c);
+    cell = kind;
+}
+
+bool ArenaMirror::apply(const std::string& payload) {
+    if (payload.empty())
+        return false;
+    if (payload[0] == static_cast<char>(ArenaMessage::Keyframe))
+        return applyKeyframe(payload);
+    if (payload[0] == static_cast<char>(ArenaMessage::Tick))
+        return ready() && applyTick(payload);
+    return false;
+}
+
+bool ArenaMirror::applyKeyframe(const std::string& payload) {
+    VarintReader in = { reinterpret_cast<const uint8_t*>(payload.data()) + 1,
+                        reinterpret_cast<const uint8_t*>(payload.data()) + payload.size() };
+    const uint64_t newHalfCols = in.varint();
+    const uint64_t newHalfRows = in.varint();
+    if (!in.ok || newHalfCols < 2 || newHalfRows < 1 || newHalfCols * newHalfRows > MaxBoardCells / 4)
+        return false;
+    halfCols = static_cast<int>(newHalfCols);
+    halfRows = static_cast<int>(newHalfRows);
+    cols = 2 * halfCols;
+    rowCount = 2 * halfRows;
+    ticks = static_cast<uint32_t>(in.varint());
+    grid.assign(static_cast<size_t>(cols) * rowCount, CellKind::Empty);
+    foodCells.clear();
+    players.clear();
+
+    for (size_t i = 0; i < grid.size() && in.ok;) {
+        const uint64_t run = in.varint();
+        const uint64_t kind = run & 7;
+        if (run >> 3 == 0 || run >> 3 > grid.size() - i || kind > static_cast<uint64_t>(CellKind::Wall)) {
+            cols = 0;
+            return false;
+        }
+        for (uint64_t n = 0; n < run >> 3; ++n, ++i) {
+            grid[i] = static_cast<CellKind>(kind);
+            if (grid[i] == CellKind::Food)
+                foodCells.push_back(cellAtIndex(i));
+        }
+    }
+
+    const uint64_t count = in.varint();
+    if (!in.ok || count > static_cast<uint64_t>(in.end - in.p)) {
+        cols = 0;
+        return false;
+    }
+    players.resize(static_cast<size_t>(count));
+    for (ArenaMirrorSnake& snake : players) {
+        const uint64_t length = in.varint();
+        if (length == 0)
+            continue;
+        snake.alive = true;
+        snake.heading = static_cast<Direction>(std::min<uint64_t>(in.varint(), 4));
+        snake.score = static_cast<int>(in.varint());
+        const uint64_t tail = in.varint();
+        if (!in.ok || tail >= grid.size() || length > grid.size()) {
+            cols = 0;
+            return false;
+        }
+        Cell cell = cellAtIndex(tail);
+        snake.body.push_back(cell);
+        uint8_t packed = 0;
+        for (uint64_t i = 1; i < length && in.ok; ++i) {
+            if ((i - 1) % 4 == 0)
+                in.bytes(&packed, 1);
+            const Direction step = static_cast<Direction>(((packed >> ((i - 1) % 4 * 2)) & 3) + 1);
+            cell = wrapped({ cell.x + directionX(step), cell.y + directionY(step) }, halfCols, halfRows);
+            snake.body.push_back(cell);
+        }
+    }
+    if (!in.ok)
+        cols = 0;
+    return in.ok;
+}
+
+bool ArenaMirror::applyTick(const std::string& payload) {
+    VarintReader in = { reinterpret_cast<const uint8_t*>(payload.data()) + 1,
+                        reinterpret_cast<const uint8_t*>(payload.data()) + payload.size() };
+    const uint64_t tick = in.varint();
+    const uint64_t count = in.varint();
+    if (!in.ok || tick != static_cast<uint64_t>(ticks) + 1)
+        return false;
+    ticks = static_cast<uint32_t>(tick);
+
+    // The server frees every tail before placing any head, so a head may
+    // take a cell a tail left in the same tick; heads wait in moves until
+    // the run of Move and Grow events is over
+    moves.clear();
+    auto placeHeads = [this] {
+        for (const auto& move : moves) {
+            ArenaMirrorSnake& snake = players[move.first];
+            const Cell head = snake.body.back();
+            const Cell next = wrapped({ head.x + directionX(move.second), head.y + directionY(move.second) }, halfCols,
+                                      halfRows);
+            snake.heading = move.second;
+            if (cellAt(next) == CellKind::Food)
+                snake.score += 1;
+            snake.body.push_back(next);
+            set(next, CellKind::Snake);
+        }
+        moves.clear();
+    };
+
+    for (uint64_t e = 0; e < count && in.ok; ++e) {
+        const uint64_t tag = in.varint();
+        const uint64_t code = tag & 15;
+        if (code >= DeathCode)
+            placeHeads();
+        if (code < DeathCode) {
+            ArenaMirrorSnake* mover = snake(tag >> 4, false);
+            if (!mover || !mover->alive)
+                return false;
+            if (code < GrowCode) {
+                set(mover->body.front(), CellKind::Empty);
+                mover->body.pop_front();
+            }
+            moves.push_back({ static_cast<int>(tag >> 4), Directions[code & 3] });
+        }
+        else if (code == DeathCode) {
+            ArenaMirrorSnake* dead = snake(tag >> 4, false);
+            if (!dead || !dead->alive)
+                return false;
+            for (const Cell& c : dead->body)
+                set(c, CellKind::Empty);
+            dead->body.clear();
+            dead->alive = false;
+            dead->heading = Direction::None;
+        }
+        else if (code == JoinCode) {
+            ArenaMirrorSnake* joined = snake(tag >> 4, true);
+            const uint64_t operand = in.varint();
+            if (!joined || joined->alive || operand >> 2 >= grid.size())
+                return false;
+            joined->alive = true;
+            joined->heading = Directions[operand & 3];
+            joined->score = 0;
+            const Cell head = cellAtIndex(operand >> 2);
+            for (int i = ArenaEngine::JoinLength - 1; i >= 0; --i) {
+                const Cell c = wrapped({ head.x - i * directionX(joined->heading), head.y - i * directionY(joined->heading) },
+                                       halfCols, halfRows);
+                joined->body.push_back(c);
+                set(c, CellKind::Snake);
+            }
+        }
+        else if (code == SpawnCode) {
+            const uint64_t operand = in.varint();
+            const uint64_t kind = operand & 7;
+            if (operand >> 3 >= grid.size() || kind > static_cast<uint64_t>(CellKind::Wall))
+                return false;
+            set(cellAtIndex(operand >> 3), static_cast<CellKind>(kind));
+        }
+        else if (code == ClearCode) {
+            const uint64_t operand = in.varint();
+            if (operand >= grid.size())
+                return false;
+            set(cellAtIndex(operand), CellKind::Empty);
+        }
+        else {
+            return false;
+        }
+    }
+    placeHeads();
+    return in.ok;
+}
+
+Direction arenaBotTurn(const ArenaMirror& board, int snake, Rng& rng) {
+    const ArenaMirrorSnake& self = board.snakes()[snake];
+    const bool wander = rng.bounded(20) == 0;
+    const int halfCols = board.columns() / 2;
+    const int halfRows = board.rows() / 2;
+    const Cell head = self.body.back();
+    Direction best = self.heading;
+    int bestDistance = -1;
+    for (Direction d : Directions) {
+        if (isReversal(d, self.heading))
+            continue;
+        const Cell next = wrapped({ head.x + directionX(d), head.y + directionY(d) }, halfCols, halfRows);
+        const CellKind kind = board.cellAt(next);
+        if (kind != CellKind::Empty && kind != CellKind::Food && next != self.body.front())
+            continue;
+
+        int distance = 0;
+        if (wander) {
+            distance = static_cast<int>(rng.bounded(4));
+        }
+        else {
+            distance = board.columns() + board.rows();
+            for (const Cell& food : board.foods()) {
+                const int dx = std::abs(food.x - next.x);
+                const int dy = std::abs(food.y - next.y);
+                distance = std::min(distance, std::min(dx, board.columns() - dx) + std::min(dy, board.rows() - dy));
+            }
+        }
+        if (bestDistance < 0 || distance < bestDistance || (distance == bestDistance && d == self.heading)) {
+            bestDistance = distance;
+            best = d;
+        }
+    }
+    return best;
+}
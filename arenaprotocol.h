@@ -0,0 +1,99 @@
+#ifndef ARENAPROTOCOL_H
+#define ARENAPROTOCOL_H
+
+#include "arena.h"
+#include "gametypes.h"
+#include "rng.h"
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Wire format of the arena server. Every message is a varint payload length
+// followed by the payload, whose first byte is its type. Cells travel as
+// grid indices (row-major, bottom row first).
+//
+// A client gets one Keyframe on connecting (the whole board, run-length
+// encoded, and every snake as its tail plus 2-bit steps), then one Tick per
+// step holding only what changed. In a Tick each event is a varint tag,
+// snake << 4 | code, where codes 0-3 move a head on in a direction and drop
+// the tail, 4-7 do the same keeping the tail, and the rest are rarer events
+// with their own operand. A few dozen snakes cost a few dozen bytes a tick.
+enum class ArenaMessage : uint8_t {
+    Keyframe = 1,   // server: the whole game
+    Tick = 2,       // server: one step's events
+    Welcome = 3,    // server: the snake id a Join got, or -1 when there was no room
+    Join = 16,      // client: play
+    Turn = 17,      // client: a direction for my snake, from the next step on
+};
+
+std::string encodeArenaKeyframe(const ArenaEngine& arena);
+std::string encodeArenaTick(const ArenaEngine& arena); // arena.changes(), for the step just run
+std::string encodeArenaWelcome(int snake);
+std::string encodeArenaJoin();
+std::string encodeArenaTurn(Direction direction);
+
+// Splits a byte stream back into payloads, however it was cut up in transit
+class ArenaFramer
+{
+public:
+    void feed(const char* data, size_t size);
+    bool next(std::string& payload); // false until a whole message is in; sets failed on garbage
+    bool failed() const { return broken; }
+
+private:
+    std::string buffer;
+    size_t offset = 0;
+    bool broken = false;
+};
+
+struct ArenaMirrorSnake {
+    bool alive = false;
+    Direction heading = Direction::None;
+    int score = 0;
+    std::deque<Cell> body; // tail first
+};
+
+// A client's copy of the board, built from a Keyframe and kept current by
+// Ticks. It ends up cell for cell identical to the server's.
+class ArenaMirror
+{
+public:
+    bool apply(const std::string& payload);  // Keyframe or Tick; false if malformed or out of order
+
+    bool ready() const { return cols > 0; }
+    int columns() const { return cols; }
+    int rows() const { return rowCount; }
+    uint32_t tick() const { return ticks; }
+    CellKind cellAt(Cell c) const { return grid[index(c)]; }
+    const std::vector<CellKind>& cells() const { return grid; }
+    const std::vector<ArenaMirrorSnake>& snakes() const { return players; }
+    const std::vector<Cell>& foods() const { return foodCells; }
+
+private:
+    bool applyKeyframe(const std::string& payload);
+    bool applyTick(const std::string& payload);
+    int index(Cell c) const { return (c.y + halfRows) * cols + (c.x + halfCols); }
+    Cell cellAtIndex(uint64_t i) const {
+        return { static_cast<int>(i % cols) - halfCols, static_cast<int>(i / cols) - halfRows };
+    }
+    ArenaMirrorSnake* snake(uint64_t id, bool create);
+    void set(Cell c, CellKind kind);
+
+    int halfCols = 0;
+    int halfRows = 0;
+    int cols = 0;
+    int rowCount = 0;
+    uint32_t ticks = 0;
+    std::vector<CellKind> grid;
+    std::vector<ArenaMirrorSnake> players;
+    std::vector<Cell> foodCells;
+    std::vector<std::pair<int, Direction>> moves; // this tick's heads, applied after every tail
+};
+
+// The bot behind --serve --bots and the arena bench: heads for the nearest
+// food the short way round, never into a taken cell, with the occasional
+// random turn so it cannot circle behind a wall forever.
+Direction arenaBotTurn(const ArenaMirror& board, int snake, Rng& rng);
+
+#endif // ARENAPROTOCOL_H
@@ -0,0 +1,226 @@
+#include "arenaserver.h"
+#include "trace.h"
+#include <QHostAddress>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <algorithm>
+
+namespace {
+
+const qint64 MaxBacklog = 1 << 20; // unsent bytes after which a client is given up on
+const size_t TickHistory = 4096;   // ticks kept for the latency percentiles
+
+} // namespace
+
+double ArenaServerStats::percentileUs(int percent) const {
+    if (tickNs.empty())
+        return 0.0;
+    std::vector<int64_t> sorted = tickNs;
+    const size_t rank = std::min(sorted.size() - 1, sorted.size() * static_cast<size_t>(percent) / 100);
+    std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(rank), sorted.end());
+    return sorted[rank] / 1e3;
+}
+
+ArenaServer::ArenaServer(const ArenaConfig& config, int tickMs, QObject* parent)
+    : QObject(parent)
+    , engine(config)
+    , tickMs(std::max(1, tickMs))
+{
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    timer->setTimerType(Qt::PreciseTimer);
+    connect(timer, &QTimer::timeout, this, &ArenaServer::tick);
+}
+
+ArenaServer::~ArenaServer()
+{
+    for (Client* client : clients)
+        forget(client);
+}
+
+// Frees a client; its socket, if still there, no longer reports to us
+void ArenaServer::forget(Client* client) {
+    if (client->socket) {
+        client->socket->disconnect(this);
+        client->socket->deleteLater();
+    }
+    delete client;
+}
+
+bool ArenaServer::listenTcp(quint16 port) {
+    if (!tcpServer) {
+        tcpServer = new QTcpServer(this);
+        connect(tcpServer, &QTcpServer::newConnection, this, &ArenaServer::acceptTcp);
+    }
+    if (tcpServer->listen(QHostAddress::LocalHost, port))
+        return true;
+    error = tcpServer->errorString();
+    return false;
+}
+
+bool ArenaServer::listenLocal(const QString& name) {
+    if (!localServer) {
+        localServer = new QLocalServer(this);
+        connect(localServer, &QLocalServer::newConnection, this, &ArenaServer::acceptLocal);
+    }
+    QLocalServer::removeServer(name); // left behind by a server that crashed
+    if (localServer->listen(name))
+        return true;
+    error = localServer->errorString();
+    return false;
+}
+
+quint16 ArenaServer::tcpPort() const {
+    return tcpServer ? tcpServer->serverPort() : 0;
+}
+
+void ArenaServer::acceptTcp() {
+    while (QTcpSocket* socket = tcpServer->nextPendingConnection()) {
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        addClient(socket);
+    }
+}
+
+void ArenaServer::acceptLocal() {
+    while (QLocalSocket* socket = localServer->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        addClient(socket);
+    }
+}
+
+// New clients wait for the end of the next tick for their keyframe, so it
+// lines up with the tick messages that follow
+void ArenaServer::addClient(QIODevice* socket) {
+    Client* client = new Client;
+    client->socket = socket;
+    clients.push_back(client);
+    connect(socket, &QIODevice::readyRead, this, [this, client] { readClient(client); });
+    connect(socket, &QObject::destroyed, this, [this, client] { dropClient(client); });
+}
+
+void ArenaServer::readClient(Client* client) {
+    if (client->gone)
+        return;
+    const QByteArray data = client->socket->readAll();
+    client->framer.feed(data.constData(), static_cast<size_t>(data.size()));
+    std::string payload;
+    while (client->framer.next(payload)) {
+        const ArenaMessage type = static_cast<ArenaMessage>(payload[0]);
+        if (type == ArenaMessage::Join && client->snake < 0) {
+            client->snake = engine.join();
+            if (client->snake >= 0) {
+                if (owners.size() <= static_cast<size_t>(client->snake))
+                    owners.resize(static_cast<size_t>(client->snake) + 1, nullptr);
+                owners[client->snake] = client;
+            }
+            send(client, QByteArray::fromStdString(encodeArenaWelcome(client->snake)));
+        }
+        else if (type == ArenaMessage::Turn && payload.size() == 2 && client->snake >= 0) {
+            const uint8_t direction = static_cast<uint8_t>(payload[1]);
+            if (direction <= static_cast<uint8_t>(Direction::Down))
+                engine.turn(client->snake, static_cast<Direction>(direction));
+        }
+    }
+    if (client->framer.failed())
+        dropClient(client);
+}
+
+// The socket is going away; its snake leaves with it. The Client itself is
+// freed after the current tick, since a broadcast may still hold it.
+void ArenaServer::dropClient(Client* client) {
+    if (client->gone)
+        return;
+    client->gone = true;
+    if (client->socket)
+        client->socket->close();
+    if (client->snake >= 0) {
+        engine.leave(client->snake);
+        owners[client->snake] = nullptr;
+        client->snake = -1;
+    }
+}
+
+void ArenaServer::send(Client* client, const QByteArray& data) {
+    if (client->gone || !client->socket)
+        return;
+    if (client->socket->bytesToWrite() > MaxBacklog) {
+        ++counters.dropped;
+        dropClient(client);
+        return;
+    }
+    client->socket->write(data);
+    counters.sentBytes += data.size();
+}
+
+void ArenaServer::start() {
+    clock.start();
+    stepClock.start(0, tickMs * 1000000LL);
+    scheduleTick();
+}
+
+void ArenaServer::stop() {
+    timer->stop();
+}
+
+void ArenaServer::resetStats() {
+    counters = ArenaServerStats();
+}
+
+void ArenaServer::scheduleTick() {
+    const qint64 waitNs = stepClock.nextDeadlineNs() - clock.nsecsElapsed();
+    timer->start(static_cast<int>(std::max<qint64>(0, (waitNs + 999999) / 1000000)));
+}
+
+void ArenaServer::tick() {
+    const int steps = stepClock.advance(clock.nsecsElapsed());
+    for (int i = 0; i < steps; ++i) {
+        TRACE_SCOPE("ArenaServer::tick");
+        const qint64 begin = clock.nsecsElapsed();
+        const std::vector<ArenaEvent>& events = engine.step(engine.tick() * static_cast<int64_t>(tickMs));
+        for (const ArenaEvent& event : events) {
+            if (event.kind == ArenaEventKind::Death && event.snake < static_cast<int>(owners.size())
+                && owners[event.snake]) {
+                owners[event.snake]->snake = -1;
+                owners[event.snake] = nullptr;
+            }
+        }
+
+        // One encoding, shared by every socket. Both are taken before any
+        // send: a client dropped for its backlog leaves the arena there and
+        // then, and a keyframe taken after that would show its snake dead
+        // ahead of the Death event in the next tick.
+        const QByteArray frame = QByteArray::fromStdString(encodeArenaTick(engine));
+        QByteArray keyframe;
+        if (std::any_of(clients.begin(), clients.end(), [](const Client* c) { return !c->synced && !c->gone; }))
+            keyframe = QByteArray::fromStdString(encodeArenaKeyframe(engine));
+        for (Client* client : clients) {
+            if (client->synced) {
+                send(client, frame);
+            }
+            else if (!client->gone) {
+                send(client, keyframe);
+                client->synced = true;
+            }
+        }
+
+        ++counters.ticks;
+        counters.frameBytes += frame.size();
+        counters.maxFrameBytes = std::max<int64_t>(counters.maxFrameBytes, frame.size());
+        if (counters.tickNs.size() == TickHistory)
+            counters.tickNs.erase(counters.tickNs.begin());
+        counters.tickNs.push_back(clock.nsecsElapsed() - begin);
+    }
+    counters.clock = stepClock.stats();
+
+    auto gone = std::stable_partition(clients.begin(), clients.end(), [](Client* client) { return !client->gone; });
+    for (auto it = gone; it != clients.end(); ++it)
+        forget(*it);
+    clients.erase(gone, clients.end());
+
+    emit ticked();
+    scheduleTick();
+}
@@ -0,0 +1,93 @@
+#ifndef ARENASERVER_H
+#define ARENASERVER_H
+
+#include "arena.h"
+#include "arenaprotocol.h"
+#include "fixedstep.h"
+#include <QElapsedTimer>
+#include <QIODevice>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <vector>
+
+class QLocalServer;
+class QTcpServer;
+class QTimer;
+
+struct ArenaServerStats {
+    int64_t ticks = 0;
+    int64_t frameBytes = 0;     // tick messages as encoded, once each
+    int64_t maxFrameBytes = 0;
+    int64_t sentBytes = 0;      // everything written, to every client
+    int64_t dropped = 0;        // clients cut off for falling too far behind
+    std::vector<int64_t> tickNs; // step + encode + broadcast, per tick, most recent last
+    TickStats clock;            // how late the ticks ran against their deadlines
+
+    double meanFrameBytes() const { return ticks ? static_cast<double>(frameBytes) / ticks : 0.0; }
+    double percentileUs(int percent) const;
+};
+
+// The authoritative side of a multi-snake game. Clients connect over TCP
+// (loopback only) or a local socket, get a keyframe, then one tick message
+// per step with just that step's changes. Players send Join and Turn; the
+// server runs ArenaEngine on a fixed step and never waits for anyone: a
+// client that stops reading is dropped once its backlog passes a limit.
+class ArenaServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ArenaServer(const ArenaConfig& config, int tickMs, QObject* parent = nullptr);
+    ~ArenaServer();
+
+    bool listenTcp(quint16 port);               // 0 picks a free port
+    bool listenLocal(const QString& name);
+    quint16 tcpPort() const;
+    QString errorString() const { return error; }
+
+    void start();
+    void stop();
+    const ArenaEngine& arena() const { return engine; }
+    int clientCount() const { return static_cast<int>(clients.size()); }
+    const ArenaServerStats& stats() const { return counters; }
+    void resetStats();
+
+signals:
+    void ticked();
+
+private slots:
+    void acceptTcp();
+    void acceptLocal();
+    void tick();
+
+private:
+    struct Client {
+        QPointer<QIODevice> socket;  // cleared when the socket is deleted
+        ArenaFramer framer;
+        int snake = -1;
+        bool synced = false;      // has had its keyframe
+        bool gone = false;
+    };
+
+    void addClient(QIODevice* socket);
+    void readClient(Client* client);
+    void dropClient(Client* client);
+    void forget(Client* client);
+    void send(Client* client, const QByteArray& data);
+    void scheduleTick();
+
+    ArenaEngine engine;
+    int tickMs;
+    QTcpServer* tcpServer = nullptr;
+    QLocalServer* localServer = nullptr;
+    QString error;
+    QTimer* timer;
+    QElapsedTimer clock;
+    FixedStepClock stepClock;
+    std::vector<Client*> clients;
+    std::vector<Client*> owners;  // by snake id, the client playing it
+    ArenaServerStats counters;
+};
+
+#endif // ARENASERVER_H
@@ -0,0 +1,269 @@
+#include "autopilot.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+
+namespace {
+const Direction Directions[4] = { Direction::Right, Direction::Left, Direction::Up, Direction::Down };
+}
+
+void Autopilot::reset(const GameEngine& game) {
+    cols = game.columns();
+    rows = game.rows();
+    halfCols = game.config().halfCols;
+    halfRows = game.config().halfRows;
+    const int cells = cols * rows;
+    parent.assign(cells, -1);
+    distance.assign(cells, 0);
+    queue.assign(cells, 0);
+    seen.assign(cells, 0);
+    stamp = 0;
+    planStats = PlanStats();
+
+    cycleIndex.clear();
+    offCycle = false;
+    const bool open = std::none_of(game.cells(), game.cells() + cells,
+                                   [](CellKind k) { return k == CellKind::Wall; });
+    if (open && cols % 2 == 0 && rows % 2 == 0 && cols >= 4 && rows >= 4)
+        buildCycle();
+}
+
+int Autopilot::neighbour(int cell, Direction d) const {
+    int x = cell % cols;
+    int y = cell / cols;
+    x += directionX(d);
+    y += directionY(d);
+    // The board wraps around, as in GameEngine::step
+    if (x < 0)
+        x = cols - 1;
+    else if (x >= cols)
+        x = 0;
+    if (y < 0)
+        y = rows - 1;
+    else if (y >= rows)
+        y = 0;
+    return y * cols + x;
+}
+
+// Free, food, or the tail cell, which moves away during the step
+bool Autopilot::passable(const GameEngine& game, int cell, int tail) const {
+    const CellKind kind = game.cells()[cell];
+    return kind == CellKind::Empty || kind == CellKind::Food || (kind == CellKind::Snake && cell == tail);
+}
+
+int Autopilot::cycleDistance(int from, int to) const {
+    const int n = static_cast<int>(cycleIndex.size());
+    return (cycleIndex[to] - cycleIndex[from] + n) % n;
+}
+
+// Column 0 is the way back down; the rest is swept row by row, alternating
+// direction. The order is then reversed so that odd rows run rightwards,
+// which puts the starting snake (on the middle row, heading right) on the
+// cycle in order.
+void Autopilot::buildCycle() {
+    std::vector<int> order;
+    order.reserve(cols * rows);
+    for (int x = 0; x < cols; ++x)
+        order.push_back(x);
+    for (int y = 1; y < rows; ++y) {
+        if (y % 2 == 1) {
+            for (int x = cols - 1; x >= 1; --x)
+                order.push_back(y * cols + x);
+        }
+        else {
+            for (int x = 1; x < cols; ++x)
+                order.push_back(y * cols + x);
+        }
+    }
+    for (int y = rows - 1; y >= 1; --y)
+        order.push_back(y * cols);
+    std::reverse(order.begin(), order.end());
+
+    cycleIndex.assign(cols * rows, 0);
+    for (int i = 0; i < static_cast<int>(order.size()); ++i)
+        cycleIndex[order[i]] = i;
+}
+
+uint32_t Autopilot::nextStamp() {
+    if (++stamp == 0) {
+        std::fill(seen.begin(), seen.end(), 0);
+        stamp = 1;
+    }
+    return stamp;
+}
+
+Direction Autopilot::plan(const GameEngine& game) {
+    TRACE_SCOPE("Autopilot::plan");
+    const auto started = std::chrono::steady_clock::now();
+
+    const int head = cellIndex(game.snake().head());
+    const int tail = cellIndex(game.snake().tail());
+    const int food = game.hasFood() ? cellIndex(game.food()) : -1;
+    // A bomb in the gap ahead of the head can force it off the cycle; search
+    // until the body is back in cycle order
+    if (offCycle && bodyInCycleOrder(game))
+        offCycle = false;
+    Direction choice = Direction::None;
+    if (usesCycle() && !offCycle)
+        choice = cyclePlan(game, head, tail, food);
+    if (choice == Direction::None) {
+        offCycle = usesCycle();
+        choice = searchPlan(game, head, tail, food);
+    }
+
+    const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+    ++planStats.plans;
+    planStats.totalNs += ns;
+    planStats.maxNs = std::max(planStats.maxNs, ns);
+    return choice;
+}
+
+// Shortcut rule: a move may jump ahead along the cycle only if it lands in
+// the empty stretch between head and tail with room to grow, so the body
+// stays in cycle order and the plain cycle is always still available.
+Direction Autopilot::cyclePlan(const GameEngine& game, int head, int tail, int food) {
+    const int cells = cols * rows;
+    const int length = game.snake().size();
+    const int room = cycleDistance(head, tail);
+    int bombAhead = -1; // the nearest bomb along the cycle
+    for (const Cell& bomb : game.bombs()) {
+        const int distance = cycleDistance(head, cellIndex(bomb));
+        if (bombAhead < 0 || distance < bombAhead)
+            bombAhead = distance;
+    }
+
+    Direction best = Direction::None;
+    int bestScore = INT_MAX;
+    for (Direction d : Directions) {
+        const int next = neighbour(head, d);
+        if (!passable(game, next, tail))
+            continue;
+
+        // Once the body is long, jump ahead only to get past the bomb
+        const int ahead = cycleDistance(head, next);
+        const bool skipsBomb = bombAhead > 0 && ahead > bombAhead;
+        if (ahead != 1 && (ahead >= room - 3 || (length * 2 > cells && !skipsBomb)))
+            continue;
+
+        const int score = food >= 0 ? cycleDistance(next, food) : ahead;
+        if (score < bestScore) {
+            bestScore = score;
+            best = d;
+        }
+    }
+    return best;
+}
+
+bool Autopilot::bodyInCycleOrder(const GameEngine& game) const {
+    const SnakeBody& body = game.snake();
+    const int tail = cellIndex(body.tail());
+    int previous = -1;
+    for (const Cell& c : body) {
+        const int position = cycleDistance(tail, cellIndex(c));
+        if (position <= previous)
+            return false;
+        previous = position;
+    }
+    return true;
+}
+
+// Shortest path to the food, taken only while the tail can still be reached
+// from the first step; otherwise stall by chasing the tail the long way round.
+Direction Autopilot::searchPlan(const GameEngine& game, int head, int tail, int food) {
+    if (food >= 0 && search(game, head, food, tail) >= 0) {
+        int step = food;
+        while (parent[step] != head)
+            step = parent[step];
+        if (search(game, step, tail, tail) >= 0)
+            return directionTo(head, step);
+    }
+
+    Direction best = Direction::None;
+    int bestDistance = -1;
+    for (Direction d : Directions) {
+        const int next = neighbour(head, d);
+        if (!passable(game, next, tail))
+            continue;
+        const int distance = search(game, next, tail, tail);
+        if (distance > bestDistance) {
+            bestDistance = distance;
+            best = d;
+        }
+    }
+    return best != Direction::None ? best : roomiestMove(game, head, tail);
+}
+
+// BFS from start to goal over passable cells; fills parent and returns the
+// number of steps, or -1 if goal cannot be reached
+int Autopilot::search(const GameEngine& game, int start, int goal, int tail) {
+    if (start == goal)
+        return 0;
+    const uint32_t mark = nextStamp();
+    int readAt = 0;
+    int writeAt = 0;
+    queue[writeAt++] = start;
+    seen[start] = mark;
+    parent[start] = -1;
+    distance[start] = 0;
+    while (readAt < writeAt) {
+        const int cell = queue[readAt++];
+        for (Direction d : Directions) {
+            const int next = neighbour(cell, d);
+            if (seen[next] == mark || !passable(game, next, tail))
+                continue;
+            seen[next] = mark;
+            parent[next] = cell;
+            distance[next] = distance[cell] + 1;
+            if (next == goal)
+                return distance[next];
+            queue[writeAt++] = next;
+        }
+    }
+    return -1;
+}
+
+Direction Autopilot::directionTo(int from, int to) const {
+    for (Direction d : Directions) {
+        if (neighbour(from, d) == to)
+            return d;
+    }
+    return Direction::None;
+}
+
+Direction Autopilot::roomiestMove(const GameEngine& game, int head, int tail) {
+    const int limit = game.snake().size() * 2;
+    Direction best = game.direction();
+    int bestRoom = -1;
+    for (Direction d : Directions) {
+        const int next = neighbour(head, d);
+        if (!passable(game, next, tail))
+            continue;
+        const int room = floodCount(game, next, tail, limit);
+        if (room > bestRoom || (room == bestRoom && d == game.direction())) {
+            bestRoom = room;
+            best = d;
+        }
+    }
+    return best;
+}
+
+// Cells reachable from start, counting at most limit of them
+int Autopilot::floodCount(const GameEngine& game, int start, int tail, int limit) {
+    const uint32_t mark = nextStamp();
+    int readAt = 0;
+    int writeAt = 0;
+    queue[writeAt++] = start;
+    seen[start] = mark;
+    while (readAt < writeAt && writeAt < limit) {
+        const int cell = queue[readAt++];
+        for (Direction d : Directions) {
+            const int next = neighbour(cell, d);
+            if (seen[next] == mark || !passable(game, next, tail))
+                continue;
+            seen[next] = mark;
+            queue[writeAt++] = next;
+        }
+    }
+    return writeAt;
+}
@@ -0,0 +1,59 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include "gameengine.h"
+#include <cstdint>
+#include <vector>
+
+struct PlanStats {
+    int64_t plans = 0;
+    int64_t totalNs = 0;
+    int64_t maxNs = 0;
+};
+
+// Computer player. On an open board with even sides it follows a Hamiltonian
+// cycle and only takes shortcuts that keep the body in cycle order, which
+// cannot trap it; a bomb dropped right in its path can still knock it off the
+// cycle, and it searches until the body is back in order. Elsewhere it runs
+// BFS to the food, taking the path only if the tail stays reachable, and
+// otherwise chases its tail. All search buffers are sized once per board and
+// reused every tick.
+class Autopilot
+{
+public:
+    void reset(const GameEngine& game);
+    Direction plan(const GameEngine& game);   // heading for the next step
+
+    bool usesCycle() const { return !cycleIndex.empty(); }
+    const PlanStats& stats() const { return planStats; }
+
+private:
+    int cellIndex(Cell c) const { return (c.y + halfRows) * cols + (c.x + halfCols); }
+    int neighbour(int cell, Direction d) const;
+    bool passable(const GameEngine& game, int cell, int tail) const;
+    int cycleDistance(int from, int to) const;
+    void buildCycle();
+    bool bodyInCycleOrder(const GameEngine& game) const;
+    Direction cyclePlan(const GameEngine& game, int head, int tail, int food);
+    Direction searchPlan(const GameEngine& game, int head, int tail, int food);
+    int search(const GameEngine& game, int start, int goal, int tail);
+    Direction directionTo(int from, int to) const;
+    Direction roomiestMove(const GameEngine& game, int head, int tail);
+    int floodCount(const GameEngine& game, int start, int tail, int limit);
+    uint32_t nextStamp();
+
+    int cols = 0;
+    int rows = 0;
+    int halfCols = 0;
+    int halfRows = 0;
+    std::vector<int> cycleIndex;  // position of every cell on the cycle, empty if none
+    bool offCycle = false;        // knocked out of cycle order, searching instead
+    std::vector<int> parent;      // BFS tree
+    std::vector<int> distance;
+    std::vector<int> queue;
+    std::vector<uint32_t> seen;   // visit stamps, so buffers never need clearing
+    uint32_t stamp = 0;
+    PlanStats planStats;
+};
+
+#endif // AUTOPILOT_H
@@ -0,0 +1,185 @@
+#include "batchrunner.h"
+#include "autopilot.h"
+#include "gameengine.h"
+#include "rng.h"
+#include "workpool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+const Direction Directions[4] = { Direction::Right, Direction::Left, Direction::Up, Direction::Down };
+
+// Steps toward the food the shorter way round the board, never into a cell
+// that is already taken; keeps going straight when every way is blocked.
+// Now and then it takes a random free turn instead, which is what stops it
+// circling forever behind a wall with the food on the other side.
+Direction greedyTurn(const GameEngine& game, Rng& rng) {
+    const bool wander = rng.bounded(20) == 0;
+    const GameConfig& config = game.config();
+    const Cell head = game.snake().head();
+    const Direction heading = game.direction();
+    Direction best = heading;
+    int bestDistance = -1;
+    for (Direction d : Directions) {
+        if (isReversal(d, heading))
+            continue;
+        Cell next = { head.x + directionX(d), head.y + directionY(d) };
+        if (next.x < -config.halfCols)
+            next.x = config.halfCols - 1;
+        else if (next.x >= config.halfCols)
+            next.x = -config.halfCols;
+        if (next.y < -config.halfRows)
+            next.y = config.halfRows - 1;
+        else if (next.y >= config.halfRows)
+            next.y = -config.halfRows;
+
+        const CellKind kind = game.cellAt(next);
+        if (kind != CellKind::Empty && kind != CellKind::Food && next != game.snake().tail())
+            continue;
+
+        int distance = 0;
+        if (wander) {
+            distance = static_cast<int>(rng.bounded(4));
+        }
+        else if (game.hasFood()) {
+            const int dx = std::abs(game.food().x - next.x);
+            const int dy = std::abs(game.food().y - next.y);
+            distance = std::min(dx, game.columns() - dx) + std::min(dy, game.rows() - dy);
+        }
+        if (bestDistance < 0 || distance < bestDistance || (distance == bestDistance && d == heading)) {
+            bestDistance = distance;
+            best = d;
+        }
+    }
+    return best;
+}
+
+// What each worker keeps between games, so nothing is reallocated per game
+struct Worker {
+    GameEngine engine;
+    Autopilot autopilot;
+    Rng rng;
+    std::vector<BatchStats> stats;
+};
+
+} // namespace
+
+void BatchStats::merge(const BatchStats& other) {
+    games += other.games;
+    survived += other.survived;
+    boardFull += other.boardFull;
+    wallDeaths += other.wallDeaths;
+    selfDeaths += other.selfDeaths;
+    bombDeaths += other.bombDeaths;
+    ticks += other.ticks;
+    scores.insert(scores.end(), other.scores.begin(), other.scores.end());
+}
+
+double BatchStats::meanScore() const {
+    if (scores.empty())
+        return 0;
+    int64_t total = 0;
+    for (int score : scores)
+        total += score;
+    return static_cast<double>(total) / scores.size();
+}
+
+// Nearest-rank percentile of the sorted scores
+int BatchStats::scorePercentile(double p) const {
+    if (scores.empty())
+        return 0;
+    const size_t rank = static_cast<size_t>(p / 100 * (scores.size() - 1) + 0.5);
+    return scores[std::min(rank, scores.size() - 1)];
+}
+
+BatchRun runBatch(const std::vector<BatchPoint>& points, const BatchSettings& settings) {
+    const auto started = std::chrono::steady_clock::now();
+    WorkStealingPool pool(settings.threads);
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (int i = 0; i < pool.threadCount(); ++i) {
+        workers.push_back(std::make_unique<Worker>());
+        workers.back()->stats.resize(points.size());
+    }
+
+    const size_t games = static_cast<size_t>(std::max(0, settings.gamesPerPoint));
+    pool.run(points.size() * games, [&](size_t job, int worker) {
+        const BatchPoint& point = points[job / games];
+        Worker& scratch = *workers[worker];
+
+        GameConfig config;
+        config.level = point.level;
+        config.bombProbability = point.bombProbability;
+        config.bombFuseMs = point.bombFuseMs;
+        config.bombAlertMs = std::min(point.bombCooldownMs, point.bombFuseMs + 3000);
+        config.bombCooldownMs = point.bombCooldownMs;
+        // Every game draws from its own streams, whichever worker runs it
+        scratch.rng.reseed(settings.seed + job);
+        config.seed = scratch.rng.next();
+
+        GameEngine& engine = scratch.engine;
+        engine.reset(config);
+        engine.start();
+        const bool planned = settings.player == BatchPlayer::Autopilot;
+        if (planned)
+            scratch.autopilot.reset(engine);
+
+        BatchStats& stats = scratch.stats[job / games];
+        uint32_t tick = 0;
+        while (!engine.isOver() && tick < settings.maxTicks) {
+            ++tick;
+            const Direction turn = planned ? scratch.autopilot.plan(engine) : greedyTurn(engine, scratch.rng);
+            const StepResult& result = engine.step({ turn, static_cast<int64_t>(tick) * point.tickMs });
+            if (!result.gameOver)
+                continue;
+            if (result.boardFull)
+                ++stats.boardFull;
+            else if (result.collision == CellKind::Bomb)
+                ++stats.bombDeaths;
+            else if (result.collision == CellKind::Wall)
+                ++stats.wallDeaths;
+            else
+                ++stats.selfDeaths;
+        }
+        if (!engine.isOver())
+            ++stats.survived;
+        ++stats.games;
+        stats.ticks += tick;
+        stats.scores.push_back(engine.score());
+    });
+
+    BatchRun run;
+    run.threads = pool.threadCount();
+    run.stats.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        for (const auto& worker : workers)
+            run.stats[i].merge(worker->stats[i]);
+        std::sort(run.stats[i].scores.begin(), run.stats[i].scores.end());
+        run.ticks += run.stats[i].ticks;
+    }
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return run;
+}
+
+std::string batchCsv(const std::vector<BatchPoint>& points, const BatchRun& run) {
+    std::string csv = "mode,tick_ms,bomb_probability,bomb_fuse_ms,bomb_cooldown_ms,games,survived,board_full,"
+                      "wall_deaths,self_deaths,bomb_deaths,survival_rate,bomb_death_rate,mean_score,"
+                      "p50_score,p90_score,max_score,mean_seconds\n";
+    char row[512];
+    for (size_t i = 0; i < points.size(); ++i) {
+        const BatchPoint& point = points[i];
+        const BatchStats& stats = run.stats[i];
+        const double games = std::max(1, stats.games);
+        std::snprintf(row, sizeof(row), "%s,%d,%.3f,%d,%d,%d,%d,%d,%d,%d,%d,%.4f,%.4f,%.2f,%d,%d,%d,%.1f\n",
+                      point.mode.c_str(), point.tickMs, point.bombProbability, point.bombFuseMs,
+                      point.bombCooldownMs, stats.games, stats.survived, stats.boardFull, stats.wallDeaths,
+                      stats.selfDeaths, stats.bombDeaths, (stats.survived + stats.boardFull) / games,
+                      stats.bombDeaths / games, stats.meanScore(), stats.scorePercentile(50),
+                      stats.scorePercentile(90), stats.scores.empty() ? 0 : stats.scores.back(),
+                      stats.ticks * point.tickMs / 1000.0 / games);
+        csv += row;
+    }
+    return csv;
+}
@@ -0,0 +1,60 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include "level.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One combination of tuning parameters to measure
+struct BatchPoint {
+    std::string mode;                   // e.g. "Mode_2", for the report
+    std::shared_ptr<const Level> level; // none for an open board
+    int tickMs = 85;
+    double bombProbability = 0.3;
+    int bombFuseMs = 12000;
+    int bombCooldownMs = 20000;
+};
+
+enum class BatchPlayer {
+    Greedy,    // heads straight for the food, dodging only the next cell; close to a casual player
+    Autopilot  // the full planner, much slower per tick
+};
+
+struct BatchSettings {
+    int gamesPerPoint = 1000;
+    int threads = 0;                    // 0 = one per hardware thread
+    uint32_t maxTicks = 20000;          // a game still going after this counts as survived
+    BatchPlayer player = BatchPlayer::Greedy;
+    uint64_t seed = 1;                  // games are seeded from this and their index, so runs repeat exactly
+};
+
+struct BatchStats {
+    int games = 0;
+    int survived = 0;                   // still alive at maxTicks
+    int boardFull = 0;
+    int wallDeaths = 0;
+    int selfDeaths = 0;
+    int bombDeaths = 0;
+    int64_t ticks = 0;
+    std::vector<int> scores;            // sorted once the run is complete
+
+    void merge(const BatchStats& other);
+    double meanScore() const;
+    int scorePercentile(double p) const;
+};
+
+struct BatchRun {
+    std::vector<BatchStats> stats;      // one per point, in order
+    int threads = 0;
+    double seconds = 0;
+    int64_t ticks = 0;
+};
+
+BatchRun runBatch(const std::vector<BatchPoint>& points, const BatchSettings& settings);
+
+// Header plus one row per point
+std::string batchCsv(const std::vector<BatchPoint>& points, const BatchRun& run);
+
+#endif // BATCHRUNNER_H
@@ -0,0 +1,485 @@
+#include "alloccount.h"
+#include "autopilot.h"
+#include "boardwidget.h"
+#include "freecells.h"
+#include "gameengine.h"
+#include "highscorestore.h"
+#include "levelfiles.h"
+#include "levelgen.h"
+#include "replay.h"
+#include "rng.h"
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <algorithm>
+
+// Board colours, indexed by CellKind, as in the game
+static const QRgb cellPalette[] = {
+    qRgb(255, 255, 255),
+    qRgb(0, 0, 0),
+    qRgb(0, 0, 255),
+    qRgb(255, 0, 0),
+    qRgb(255, 140, 0),
+    qRgb(0, 160, 0),
+};
+
+static const int CellSize = 15;
+
+class Benchmarks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void collisionLookup_data();
+    void collisionLookup();
+    void spawn_data();
+    void spawn();
+    void tick_data();
+    void tick();
+    void tickAllocations_data();
+    void tickAllocations();
+    void fillCell_data();
+    void fillCell();
+    void generateLevel_data();
+    void generateLevel();
+    void interpolatedFrame_data();
+    void interpolatedFrame();
+    void loadHighScores_data();
+    void loadHighScores();
+    void saveHighScores();
+    void saveHighScoresLargeJournal_data();
+    void saveHighScoresLargeJournal();
+    void leaderboardQueries_data();
+    void leaderboardQueries();
+    void replayRoundTrip();
+    void hostileReplays_data();
+    void hostileReplays();
+
+private:
+    QString writeJournal(const QString& name, int lines);
+    void playInto(GameEngine& engine, int ticks);
+
+    QTemporaryDir dir;
+};
+
+void Benchmarks::initTestCase() {
+    QVERIFY(dir.isValid());
+}
+
+static void addModes() {
+    QTest::addColumn<QString>("mode");
+    QTest::newRow("Mode_1") << "Mode_1";
+    QTest::newRow("Mode_2") << "Mode_2";
+    QTest::newRow("Mode_3") << "Mode_3";
+}
+
+static GameConfig configFor(const QString& mode) {
+    GameConfig config;
+    config.level = loadLevelFile(mode);
+    config.seed = 1;
+    return config;
+}
+
+// Lets the autopilot play for a while so the board holds a realistic snake
+void Benchmarks::playInto(GameEngine& engine, int ticks) {
+    Autopilot pilot;
+    engine.start();
+    pilot.reset(engine);
+    for (int tick = 1; tick <= ticks && !engine.isOver(); ++tick)
+        engine.step({ pilot.plan(engine), tick * 55LL });
+}
+
+void Benchmarks::collisionLookup_data() {
+    addModes();
+}
+
+// The cell check step() makes for the head, over every cell of the board
+void Benchmarks::collisionLookup() {
+    QFETCH(QString, mode);
+    GameEngine engine(configFor(mode));
+    playInto(engine, 2000);
+    const GameConfig& config = engine.config();
+
+    int blocked = 0;
+    QBENCHMARK {
+        blocked = 0;
+        for (int y = -config.halfRows; y < config.halfRows; ++y) {
+            for (int x = -config.halfCols; x < config.halfCols; ++x) {
+                const CellKind kind = engine.cellAt({ x, y });
+                blocked += kind != CellKind::Empty && kind != CellKind::Food;
+            }
+        }
+    }
+    QVERIFY(blocked > 0);
+}
+
+void Benchmarks::spawn_data() {
+    QTest::addColumn<int>("fillPercent");
+    for (int fill : { 0, 50, 90, 99 })
+        QTest::addRow("%d%% full", fill) << fill;
+}
+
+// Food and bomb placement as the engine does it: a uniform pick from the
+// free-cell set, taken out when placed and put back when eaten or diffused
+void Benchmarks::spawn() {
+    QFETCH(int, fillPercent);
+    const int cells = 60 * 50;
+    FreeCells freeCells;
+    freeCells.reset(cells);
+    Rng rng(1);
+    std::vector<int> order(cells);
+    for (int i = 0; i < cells; ++i)
+        order[i] = i;
+    for (int i = cells - 1; i > 0; --i)
+        std::swap(order[i], order[rng.bounded(static_cast<uint32_t>(i + 1))]);
+    for (int i = 0; i < cells * fillPercent / 100; ++i)
+        freeCells.erase(order[i]);
+
+    QBENCHMARK {
+        const int cell = freeCells.at(static_cast<int>(rng.bounded(static_cast<uint32_t>(freeCells.size()))));
+        freeCells.erase(cell);
+        freeCells.insert(cell);
+    }
+}
+
+void Benchmarks::tick_data() {
+    addModes();
+}
+
+// One tick as MainWindow::moveSnake runs it, minus the timer: pick a turn,
+// step, paint the changed cells into the framebuffer and queue the repaint
+void Benchmarks::tick() {
+    QFETCH(QString, mode);
+    const GameConfig config = configFor(mode);
+    GameEngine engine(config);
+    Autopilot pilot;
+    BoardWidget board;
+    board.resize(2 * config.halfCols * CellSize, 2 * config.halfRows * CellSize);
+    board.setCellSize(CellSize);
+    engine.start();
+    pilot.reset(engine);
+    qint64 tick = 0;
+
+    QBENCHMARK {
+        if (engine.isOver()) {
+            engine.reset(config);
+            engine.start();
+            pilot.reset(engine);
+            tick = 0;
+        }
+        ++tick;
+        const StepResult& result = engine.step({ pilot.plan(engine), tick * 55 });
+        for (const CellChange& change : result.changes)
+            board.fillCell(change.cell.x, change.cell.y, cellPalette[static_cast<int>(change.kind)]);
+        board.flush();
+    }
+}
+
+void Benchmarks::tickAllocations_data() {
+    addModes();
+}
+
+// The same tick with bombs, expiring food and power-ups going, checked rather
+// than timed: once warmed up, no tick may allocate
+void Benchmarks::tickAllocations() {
+    if (!AllocCount::Enabled)
+        QSKIP("Allocation counting is not built in (qmake CONFIG+=alloccount)");
+    QFETCH(QString, mode);
+    GameConfig config = configFor(mode);
+    config.rules.maxBombs = 3;
+    config.rules.foodLifetimeMs = 5000;
+    config.rules.powerUpProbability = 0.02;
+    GameEngine engine(config);
+    Autopilot pilot;
+    BoardWidget board;
+    board.resize(2 * config.halfCols * CellSize, 2 * config.halfRows * CellSize);
+    board.setCellSize(CellSize);
+    engine.start();
+    pilot.reset(engine);
+
+    const int warmup = 200;
+    int allocating = 0;
+    int tick = 1;
+    for (; tick <= warmup + 5000 && !engine.isOver(); ++tick) {
+        const uint64_t before = AllocCount::allocations();
+        const StepResult& result = engine.step({ pilot.plan(engine), tick * 55LL });
+        for (const CellChange& change : result.changes)
+            board.fillCell(change.cell.x, change.cell.y, cellPalette[static_cast<int>(change.kind)]);
+        board.flush();
+        if (tick > warmup && !result.gameOver)
+            allocating += AllocCount::allocations() != before;
+    }
+    QVERIFY(tick > warmup);
+    QCOMPARE(allocating, 0);
+}
+
+void Benchmarks::fillCell_data() {
+    QTest::addColumn<int>("cellSize");
+    QTest::newRow("15 px") << 15;
+    QTest::newRow("30 px") << 30;
+}
+
+// A single cell repaint into the framebuffer
+void Benchmarks::fillCell() {
+    QFETCH(int, cellSize);
+    BoardWidget board;
+    board.resize(60 * cellSize, 50 * cellSize);
+    board.setCellSize(cellSize);
+    int x = -30;
+
+    QBENCHMARK {
+        board.fillCell(x, 0, cellPalette[x & 1]);
+        if (++x == 30)
+            x = -30;
+    }
+}
+
+void Benchmarks::generateLevel_data() {
+    QTest::addColumn<int>("style");
+    QTest::addColumn<int>("density");
+    QTest::newRow("maze 20%") << static_cast<int>(LevelStyle::Maze) << 20;
+    QTest::newRow("obstacles 20%") << static_cast<int>(LevelStyle::Obstacles) << 20;
+    QTest::newRow("obstacles 50%") << static_cast<int>(LevelStyle::Obstacles) << 50;
+}
+
+// One window-sized layout, connectivity check included, as a pool thread
+// makes it for New Game on a cache miss
+void Benchmarks::generateLevel() {
+    QFETCH(int, style);
+    QFETCH(int, density);
+    LevelSpec spec;
+    spec.style = static_cast<LevelStyle>(style);
+    spec.density = density;
+    Level level;
+
+    QBENCHMARK {
+        ++spec.seed;
+        QVERIFY(::generateLevel(spec, level));
+    }
+}
+
+void Benchmarks::interpolatedFrame_data() {
+    QTest::addColumn<bool>("tiled");
+    QTest::newRow("framebuffer") << false;
+    QTest::newRow("tiled 400x400") << true;
+}
+
+// A whole frame between two ticks, as the display asks for them: the board
+// and the snake's ends part way across their cells, on the software
+// rasteriser. 144 fps leaves about 7 ms for it.
+void Benchmarks::interpolatedFrame() {
+    QFETCH(bool, tiled);
+    GameConfig config = configFor("Mode_1");
+    if (tiled) {
+        config.halfCols = 200;
+        config.halfRows = 200;
+    }
+    GameEngine engine(config);
+    playInto(engine, 500);
+    const uint8_t* cells = reinterpret_cast<const uint8_t*>(engine.cells());
+
+    BoardWidget board;
+    board.resize(60 * CellSize, 50 * CellSize);
+    board.setCellSize(CellSize);
+    if (tiled) {
+        board.showTiled(cells, engine.columns(), engine.rows(), cellPalette);
+        board.setCamera(engine.snake().head().x, engine.snake().head().y);
+    }
+    else {
+        board.fillGrid(cells, engine.columns(), engine.rows(), cellPalette, 0, engine.rows());
+    }
+
+    const Cell head = engine.snake().head();
+    const Cell tail = engine.snake().tail();
+    BoardMotion motion;
+    motion.add({ head.x, head.y, 1, 0, cellPalette[0], 0, 1 });
+    motion.add({ tail.x, tail.y, 0, 1, cellPalette[1], 0, 1 });
+    motion.panX = 1;
+    board.setMotion(motion);
+    board.setProgressSource([] { return 0.5; });
+
+    QImage image(board.size(), QImage::Format_RGB32);
+    QBENCHMARK {
+        board.render(&image);
+    }
+}
+
+// A journal of `lines` records spread over every mode and difficulty
+QString Benchmarks::writeJournal(const QString& name, int lines) {
+    const QString path = dir.filePath(name);
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return QString();
+    const char* modes[] = { "Mode_1", "Mode_2", "Mode_3" };
+    const char* difficulties[] = { "Easy", "Medium", "Hard" };
+    Rng rng(lines);
+    QByteArray data;
+    for (int i = 0; i < lines; ++i) {
+        data += QByteArray(modes[i % 3]) + '-' + difficulties[(i / 3) % 3] + ",Player" + QByteArray::number(i % 997) + ','
+            + QByteArray::number(rng.bounded(3000)) + ",00:" + QByteArray::number(10 + rng.bounded(50)) + ':'
+            + QByteArray::number(10 + rng.bounded(50)) + '\n';
+    }
+    file.write(data);
+    return path;
+}
+
+void Benchmarks::loadHighScores_data() {
+    QTest::addColumn<int>("lines");
+    QTest::newRow("1k records") << 1000;
+    QTest::newRow("100k records") << 100000;
+    QTest::newRow("1M records") << 1000000;
+}
+
+void Benchmarks::loadHighScores() {
+    QFETCH(int, lines);
+    const QString path = writeJournal(QString("load-%1.txt").arg(lines), lines);
+    QVERIFY(!path.isEmpty());
+    HighScoreStore store(path);
+
+    Leaderboard board;
+    QBENCHMARK {
+        board = store.load();
+    }
+    QCOMPARE(board.boardCount(), 9);
+    QCOMPARE(static_cast<int>(board.size()), lines);
+}
+
+// Steady state: one record appended to the journal and waited for
+void Benchmarks::saveHighScores() {
+    HighScoreStore store(writeJournal("save.txt", 45));
+    const HighScoreEntry entry = { "Benchmark", 10, "00:01:00" };
+
+    QBENCHMARK {
+        store.append("Mode_1", "Hard", entry);
+        store.flush();
+    }
+}
+
+void Benchmarks::saveHighScoresLargeJournal_data() {
+    loadHighScores_data();
+}
+
+// The first save after a long history, which checks the end of the journal
+// before appending; it should cost the same however long the journal is
+void Benchmarks::saveHighScoresLargeJournal() {
+    QFETCH(int, lines);
+    const QString path = writeJournal(QString("journal-%1.txt").arg(lines), lines);
+    QVERIFY(!path.isEmpty());
+    HighScoreStore store(path);
+    const HighScoreEntry entry = { "Benchmark", 10, "00:01:00" };
+
+    QBENCHMARK_ONCE {
+        store.append("Mode_1", "Hard", entry);
+        store.flush();
+    }
+    QCOMPARE(static_cast<int>(store.load().size()), lines + 1);
+}
+
+void Benchmarks::leaderboardQueries_data() {
+    QTest::addColumn<int>("results");
+    QTest::newRow("10k results") << 10000;
+    QTest::newRow("1M results") << 1000000;
+}
+
+// What a game over asks of one board: insert the result, then its rank,
+// percentile and the player's best, and the top five for the labels
+void Benchmarks::leaderboardQueries() {
+    QFETCH(int, results);
+    Leaderboard board;
+    Rng rng(results);
+    for (int i = 0; i < results; ++i) {
+        board.addLoaded("Mode_1", "Hard", "Player" + QByteArray::number(i % 9973), static_cast<int>(rng.bounded(3000)),
+                        static_cast<int>(rng.bounded(3600)));
+    }
+    board.finishLoading();
+    const HighScoreEntry entry = { "Player42", 1500, "00:05:00" };
+
+    QBENCHMARK {
+        const int rank = board.add("Mode_1", "Hard", entry);
+        const ScoreBoard& scores = *board.board("Mode_1", "Hard");
+        QCOMPARE(scores.rankOf(entry.score, 300), rank + 1); // a repeat would land just behind it
+        QVERIFY(scores.percentileOf(entry.score) > 0);
+        QVERIFY(scores.best(board.playerId(entry.name)) != nullptr);
+        QCOMPARE(static_cast<int>(scores.top(5).size()), 5);
+    }
+}
+
+static Replay scriptedReplay() {
+    Replay replay;
+    replay.mode = "Mode_2";
+    replay.difficulty = "Hard";
+    replay.player = "Benchmark";
+    replay.tickMs = 55;
+    replay.seed = 7;
+    replay.levelText = encodeLevel(*loadLevelFile("Mode_2"));
+    replay.rules.maxBombs = 3;
+    replay.rules.foodLifetimeMs = 5000;
+    replay.rules.powerUpProbability = 0.02;
+    for (uint32_t tick = 3; tick < 400; tick += 7)
+        replay.inputs.push_back({ tick, tick / 7 % 2 ? Direction::Up : Direction::Right });
+    return replay;
+}
+
+static QByteArray encoded(const Replay& replay) {
+    return QByteArray::fromStdString(encodeReplay(replay));
+}
+
+// Not a benchmark: a replay survives the file format and still checks out
+void Benchmarks::replayRoundTrip() {
+    Replay replay = scriptedReplay();
+    const ReplayOutcome outcome = simulateReplay(replay, 100000);
+    QVERIFY(outcome.valid);
+    QVERIFY(outcome.ticks < 100000); // the walls end it
+    replay.claimedScore = outcome.score;
+    replay.claimedTicks = outcome.ticks;
+
+    const QByteArray data = encoded(replay);
+    Replay decoded;
+    QVERIFY(decodeReplay(data.constData(), static_cast<size_t>(data.size()), decoded));
+    QVERIFY(decoded.mode == replay.mode);
+    QVERIFY(decoded.levelText == replay.levelText);
+    QCOMPARE(decoded.seed, replay.seed);
+    QCOMPARE(decoded.rules.powerUpProbability, replay.rules.powerUpProbability);
+    QCOMPARE(decoded.inputs.size(), replay.inputs.size());
+    QVERIFY(verifyReplay(decoded));
+
+    decoded.claimedScore += 1;
+    QVERIFY(!verifyReplay(decoded));
+}
+
+void Benchmarks::hostileReplays_data() {
+    QTest::addColumn<QByteArray>("data");
+    const Replay base = scriptedReplay();
+    Replay replay = base;
+    replay.halfCols = replay.halfRows = 1 << 20;
+    QTest::newRow("huge board") << encoded(replay);
+    replay = base;
+    replay.halfCols = 2;
+    QTest::newRow("too narrow") << encoded(replay);
+    replay = base;
+    replay.rules.maxBombs = 100000;
+    QTest::newRow("more bombs than cells") << encoded(replay);
+    replay = base;
+    replay.levelText = "size 1000000 1000000\n";
+    QTest::newRow("huge level") << encoded(replay);
+    replay.levelText = "size 9999999999 10\n";
+    QTest::newRow("level size wraps") << encoded(replay);
+    replay.levelText = "size 70 10\n70. x10\n";
+    QTest::newRow("level wider than the board") << encoded(replay);
+    replay.levelText = "size 60 50\n3000000000. x50\n";
+    QTest::newRow("run wraps") << encoded(replay);
+    QTest::newRow("truncated") << encoded(base).left(40);
+}
+
+// A crafted file is turned away, without crashing or asking for gigabytes
+void Benchmarks::hostileReplays() {
+    QFETCH(QByteArray, data);
+    Replay replay;
+    GameConfig config;
+    QVERIFY(!decodeReplay(data.constData(), static_cast<size_t>(data.size()), replay) || !replayConfig(replay, config));
+}
+
+QTEST_MAIN(Benchmarks)
+#include "benchmarks.moc"
@@ -0,0 +1,15 @@
+# Hot-path microbenchmarks (QBENCHMARK). For numbers to diff between
+# revisions, write them in a machine-readable form, e.g.
+#   ./benchmarks -platform offscreen -o results.xml,xml
+#   ./benchmarks -platform offscreen -o results.csv,csv
+TARGET = benchmarks
+TEMPLATE = app
+
+QT += testlib
+CONFIG += console
+CONFIG -= app_bundle
+
+include(../core.pri)
+
+SOURCES += \
+    benchmarks.cpp
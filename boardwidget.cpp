@@ -0,0 +1,362 @@
+#include "boardwidget.h"
+#include "trace.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <algorithm>
+
+BoardWidget::BoardWidget(QWidget* parent)
+    : QFrame(parent)
+{
+    // Every pixel is covered by the framebuffer, so skip the background erase
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void BoardWidget::ensureFrame() {
+    if (frame.size() == size())
+        return;
+
+    QImage resized(size(), QImage::Format_RGB32);
+    resized.fill(Qt::white);
+    if (!frame.isNull()) {
+        QPainter painter(&resized);
+        painter.drawImage(0, 0, frame);
+    }
+    frame = resized;
+    markAllDirty();
+}
+
+// Queues a repaint; past MaxDirty rects they fold into one bounding rect
+void BoardWidget::markDirty(const QRect& rect) {
+    if (rect.isEmpty())
+        return;
+    if (dirtyCount == MaxDirty) {
+        for (int i = 1; i < dirtyCount; ++i)
+            dirty[0] |= dirty[i];
+        dirtyCount = 1;
+    }
+    if (dirtyCount == 1 && dirty[0].contains(rect))
+        return;
+    dirty[dirtyCount++] = rect;
+}
+
+void BoardWidget::markAllDirty() {
+    dirty[0] = rect();
+    dirtyCount = 1;
+}
+
+QImage& BoardWidget::canvas() {
+    ensureFrame();
+    return frame;
+}
+
+static int floorMod(int a, int b) {
+    const int m = a % b;
+    return m < 0 ? m + b : m;
+}
+
+QRect BoardWidget::cellRect(int x, int y) const {
+    return QRect(width() / 2 + x * cellSize, height() / 2 - (y + 1) * cellSize, cellSize, cellSize);
+}
+
+void BoardWidget::fillCell(int x, int y, QRgb color) {
+    if (board) {
+        // Only cached tiles need the change; the rest are drawn from the grid
+        const int col = x + boardCols / 2;
+        const int topRow = boardRows - 1 - (y + boardRows / 2);
+        const int tilesX = (boardCols + TileCells - 1) / TileCells;
+        const auto it = tiles.find(topRow / TileCells * tilesX + col / TileCells);
+        if (it == tiles.end())
+            return;
+        QImage& image = it->second.image;
+        const int left = col % TileCells * cellSize;
+        const int top = topRow % TileCells * cellSize;
+        for (int row = top; row < top + cellSize; ++row) {
+            QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(row)) + left;
+            std::fill(line, line + cellSize, color);
+        }
+        tilesChanged = true;
+        return;
+    }
+
+    ensureFrame();
+    const QRect r = cellRect(x, y).intersected(frame.rect());
+    if (r.isEmpty())
+        return;
+
+    for (int row = r.top(); row <= r.bottom(); ++row) {
+        QRgb* line = reinterpret_cast<QRgb*>(frame.scanLine(row)) + r.left();
+        std::fill(line, line + r.width(), color);
+    }
+    markDirty(r);
+}
+
+// Paints rows [rowBegin, rowEnd) of a whole board of palette indices (row-major,
+// bottom row first, centred like fillCell) straight into the framebuffer.
+void BoardWidget::fillGrid(const uint8_t* cells, int cols, int rows, const QRgb* palette, int rowBegin, int rowEnd) {
+    ensureFrame();
+    const int halfCols = cols / 2;
+    const int halfRows = rows / 2;
+    QRect touched;
+    for (int row = rowBegin; row < rowEnd && row < rows; ++row) {
+        const int y = row - halfRows;
+        const QRect strip = cellRect(-halfCols, y).united(cellRect(cols - 1 - halfCols, y)).intersected(frame.rect());
+        if (strip.isEmpty())
+            continue;
+
+        // Build the first pixel row of the strip, then copy it down
+        const uint8_t* line = cells + static_cast<size_t>(row) * cols;
+        QRgb* first = reinterpret_cast<QRgb*>(frame.scanLine(strip.top()));
+        for (int col = 0; col < cols; ++col) {
+            const QRect r = cellRect(col - halfCols, y).intersected(strip);
+            if (!r.isEmpty())
+                std::fill(first + r.left(), first + r.right() + 1, palette[line[col]]);
+        }
+        for (int py = strip.top() + 1; py <= strip.bottom(); ++py)
+            std::copy(first + strip.left(), first + strip.right() + 1, reinterpret_cast<QRgb*>(frame.scanLine(py)) + strip.left());
+        touched |= strip;
+    }
+    markDirty(touched);
+}
+
+void BoardWidget::clear(QRgb color) {
+    ensureFrame();
+    frame.fill(color);
+    markAllDirty();
+}
+
+void BoardWidget::invalidate(const QRect& rect) {
+    markDirty(rect);
+}
+
+void BoardWidget::flush() {
+    if (board) {
+        if (tilesChanged)
+            update();
+        tilesChanged = false;
+        return;
+    }
+    for (int i = 0; i < dirtyCount; ++i)
+        update(dirty[i]);
+    dirtyCount = 0;
+}
+
+void BoardWidget::paintEvent(QPaintEvent* event) {
+    {
+        TRACE_SCOPE("BoardWidget::paintEvent");
+        const bool moving = motion.slideCount > 0 || motion.panX != 0 || motion.panY != 0;
+        const double progress = moving && progressSource ? std::clamp(progressSource(), 0.0, 1.0) : 1.0;
+        QPoint shift;
+        if (board) {
+            // The camera trails the head by what is left of its move
+            const double behind = 1.0 - progress;
+            shift = QPoint(-qRound(behind * motion.panX * cellSize), qRound(behind * motion.panY * cellSize));
+        }
+
+        QPainter painter(this);
+        if (board) {
+            paintTiles(painter, shift);
+        }
+        else {
+            ensureFrame();
+            for (const QRect& r : event->region())
+                painter.drawImage(r, frame, r);
+        }
+        paintSlides(painter, progress, shift);
+        painter.end();
+
+        QFrame::paintEvent(event); // border on top
+
+        // Next frame, paced by the display
+        if (progress < 1.0) {
+            if (board)
+                update();
+            else
+                update(motionRect(QPoint()));
+        }
+    }
+    emit framePainted();
+}
+
+void BoardWidget::resizeEvent(QResizeEvent* event) {
+    QFrame::resizeEvent(event);
+    ensureFrame();
+}
+
+void BoardWidget::showTiled(const uint8_t* cells, int cols, int rows, const QRgb* palette) {
+    board = cells;
+    boardCols = cols;
+    boardRows = rows;
+    boardPalette = palette;
+    for (auto& pair : tiles)
+        spareTiles.push_back(std::move(pair.second.image));
+    tiles.clear();
+    tilesChanged = true;
+}
+
+void BoardWidget::showFramebuffer() {
+    if (!board)
+        return;
+    board = nullptr;
+    tiles.clear();
+    spareTiles.clear();
+    markAllDirty();
+}
+
+void BoardWidget::setProgressSource(std::function<double()> progress) {
+    progressSource = std::move(progress);
+}
+
+// The cells the old motion left part drawn are repainted along with the new
+// ones; in the tiled view the whole window moves anyway
+void BoardWidget::setMotion(const BoardMotion& next) {
+    if (board) {
+        motion = next;
+        update();
+        return;
+    }
+    const QRect before = motionRect(QPoint());
+    motion = next;
+    update(before.united(motionRect(QPoint())));
+}
+
+void BoardWidget::setCamera(int x, int y) {
+    if (x == cameraX && y == cameraY)
+        return;
+    cameraX = x;
+    cameraY = y;
+    tilesChanged = true;
+}
+
+// Board pixel at the top left of the tiled view, shift pixels off centring
+// the camera cell
+QPoint BoardWidget::viewOrigin(QPoint shift) const {
+    const int cameraCol = cameraX + boardCols / 2;
+    const int cameraTopRow = boardRows - 1 - (cameraY + boardRows / 2);
+    return QPoint(floorMod(cameraCol * cellSize + cellSize / 2 - width() / 2 + shift.x(), boardCols * cellSize),
+                  floorMod(cameraTopRow * cellSize + cellSize / 2 - height() / 2 + shift.y(), boardRows * cellSize));
+}
+
+// A board cell in widget pixels, in either view
+QRect BoardWidget::viewRect(int x, int y, QPoint shift) const {
+    if (!board)
+        return cellRect(x, y);
+    const QPoint origin = viewOrigin(shift);
+    const int col = x + boardCols / 2;
+    const int topRow = boardRows - 1 - (y + boardRows / 2);
+    return QRect(floorMod(col * cellSize - origin.x(), boardCols * cellSize),
+                 floorMod(topRow * cellSize - origin.y(), boardRows * cellSize), cellSize, cellSize);
+}
+
+QRect BoardWidget::motionRect(QPoint shift) const {
+    QRect r;
+    for (int i = 0; i < motion.slideCount; ++i)
+        r |= viewRect(motion.slides[i].x, motion.slides[i].y, shift);
+    return r;
+}
+
+// Each slide covers the strip of its cell the move has not reached yet
+void BoardWidget::paintSlides(QPainter& painter, double progress, QPoint shift) {
+    for (int i = 0; i < motion.slideCount; ++i) {
+        const CellSlide& slide = motion.slides[i];
+        const double done = std::clamp((progress - slide.start) / slide.span, 0.0, 1.0);
+        const int left = qRound((1.0 - done) * cellSize);
+        if (left <= 0)
+            continue;
+        QRect r = viewRect(slide.x, slide.y, shift);
+        if (slide.dx > 0)
+            r.setLeft(r.right() + 1 - left);
+        else if (slide.dx < 0)
+            r.setWidth(left);
+        else if (slide.dy > 0)
+            r.setHeight(left); // up the board is up the screen
+        else
+            r.setTop(r.bottom() + 1 - left);
+        painter.fillRect(r, QColor::fromRgb(slide.under));
+    }
+}
+
+// Walks the widget in spans that each fall inside one tile, in board pixels
+// (left to right, top to bottom), wrapping at the board edges as the snake
+// does, so the view is seamless wherever the camera is
+void BoardWidget::paintTiles(QPainter& painter, QPoint shift) {
+    ++paints;
+    const int tilePx = TileCells * cellSize;
+    const int boardWidth = boardCols * cellSize;
+    const int boardHeight = boardRows * cellSize;
+    const QPoint origin = viewOrigin(shift);
+    const int originX = origin.x();
+    const int originY = origin.y();
+
+    for (int sy = 0, wy = originY; sy < height();) {
+        const int ty = wy / tilePx;
+        const int tileHeight = std::min(tilePx, boardHeight - ty * tilePx);
+        const int spanHeight = std::min(tileHeight - (wy - ty * tilePx), height() - sy);
+        for (int sx = 0, wx = originX; sx < width();) {
+            const int tx = wx / tilePx;
+            const int tileWidth = std::min(tilePx, boardWidth - tx * tilePx);
+            const int spanWidth = std::min(tileWidth - (wx - tx * tilePx), width() - sx);
+            painter.drawImage(QRect(sx, sy, spanWidth, spanHeight), tile(tx, ty),
+                              QRect(wx - tx * tilePx, wy - ty * tilePx, spanWidth, spanHeight));
+            sx += spanWidth;
+            wx = (wx + spanWidth) % boardWidth;
+        }
+        sy += spanHeight;
+        wy = (wy + spanHeight) % boardHeight;
+    }
+
+    // What one screen can show, plus a ring of tiles the camera is heading into
+    evictTiles(static_cast<size_t>((width() / tilePx + 3) * (height() / tilePx + 3)));
+}
+
+const QImage& BoardWidget::tile(int tx, int ty) {
+    const int tilesX = (boardCols + TileCells - 1) / TileCells;
+    Tile& entry = tiles[ty * tilesX + tx];
+    entry.lastUsed = paints;
+    if (entry.image.isNull()) {
+        const int tilePx = TileCells * cellSize;
+        if (!spareTiles.empty() && spareTiles.back().width() == tilePx) {
+            entry.image = std::move(spareTiles.back());
+            spareTiles.pop_back();
+        }
+        else {
+            entry.image = QImage(tilePx, tilePx, QImage::Format_RGB32);
+        }
+        rasterize(entry.image, tx, ty);
+    }
+    return entry.image;
+}
+
+// Same scheme as fillGrid: one pixel row per cell row, copied down
+void BoardWidget::rasterize(QImage& image, int tx, int ty) const {
+    const int colBegin = tx * TileCells;
+    const int colEnd = std::min(boardCols, colBegin + TileCells);
+    for (int r = 0; r < TileCells && ty * TileCells + r < boardRows; ++r) {
+        const int gridRow = boardRows - 1 - (ty * TileCells + r);
+        const uint8_t* line = board + static_cast<size_t>(gridRow) * boardCols;
+        QRgb* first = reinterpret_cast<QRgb*>(image.scanLine(r * cellSize));
+        for (int col = colBegin; col < colEnd; ++col) {
+            QRgb* cell = first + (col - colBegin) * cellSize;
+            std::fill(cell, cell + cellSize, boardPalette[line[col]]);
+        }
+        const int rowPixels = (colEnd - colBegin) * cellSize;
+        for (int py = 1; py < cellSize; ++py)
+            std::copy(first, first + rowPixels, reinterpret_cast<QRgb*>(image.scanLine(r * cellSize + py)));
+    }
+}
+
+// Drops the least recently drawn tiles beyond keep
+void BoardWidget::evictTiles(size_t keep) {
+    if (tiles.size() <= keep)
+        return;
+    std::vector<std::pair<uint64_t, int>> byAge;
+    byAge.reserve(tiles.size());
+    for (const auto& pair : tiles)
+        byAge.push_back({ pair.second.lastUsed, pair.first });
+    std::nth_element(byAge.begin(), byAge.begin() + (tiles.size() - keep), byAge.end());
+    for (size_t i = 0; i < byAge.size() - keep; ++i) {
+        auto it = tiles.find(byAge[i].second);
+        if (spareTiles.size() < 8)
+            spareTiles.push_back(std::move(it->second.image));
+        tiles.erase(it);
+    }
+}
@@ -0,0 +1,139 @@
+#ifndef BOARDWIDGET_H
+#define BOARDWIDGET_H
+
+#include <QFrame>
+#include <QImage>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class QPainter;
+
+// One end of the snake crossing a cell between two ticks. The framebuffer
+// already shows the cell as it is after the tick; until the move is done a
+// strip on the side it is heading for still shows under, shrinking from the
+// whole cell to nothing as the tick's progress runs from start to
+// start + span. The head uncovers what it moved onto, the tail the snake.
+struct CellSlide {
+    int x = 0;          // board cell, centre-relative, y up
+    int y = 0;
+    int dx = 0;         // heading, one of them +-1
+    int dy = 0;
+    QRgb under = 0;
+    double start = 0;
+    double span = 1;
+};
+
+// What changed on the latest tick, for drawing the frames in between. It is
+// built once per tick and copied in whole, so painting never reads the game.
+struct BoardMotion {
+    static const int MaxSlides = 4; // head and tail, two cells each at double speed
+
+    std::array<CellSlide, MaxSlides> slides;
+    int slideCount = 0;
+    int panX = 0;       // cells the camera followed the head by, for the tiled view
+    int panY = 0;
+
+    void add(const CellSlide& slide) {
+        if (slideCount < MaxSlides)
+            slides[slideCount++] = slide;
+    }
+};
+
+// The play field. It keeps its own framebuffer; cell changes are painted into
+// it straight away but only reach the screen on flush(), which schedules one
+// repaint covering just the cells that changed since the previous flush.
+//
+// Boards too big for the widget are shown tiled instead: the widget is a
+// window onto the board, centred on a camera cell, and drawn from square
+// tiles that are rasterised from the cell grid only when they come into
+// view. Cached tiles are kept up to date cell by cell and the least recently
+// drawn are dropped, so memory and paint cost follow the widget size, not
+// the board size.
+//
+// Between ticks the snake's ends are drawn part way across their cells, and
+// the tiled view pans smoothly after the head. Each paint asks the progress
+// source how far into the tick it is and, while the move is unfinished,
+// requests the next frame straight away; Qt delivers those at the display's
+// refresh, so the board animates at the screen rate whatever the tick rate.
+class BoardWidget : public QFrame
+{
+    Q_OBJECT
+
+public:
+    explicit BoardWidget(QWidget* parent = nullptr);
+
+    void setCellSize(int size) { cellSize = size; }
+    int cellSizePx() const { return cellSize; }
+    QRect cellRect(int x, int y) const; // board cell (centre-relative, y up) in pixels
+
+    void fillCell(int x, int y, QRgb color);
+    void fillGrid(const uint8_t* cells, int cols, int rows, const QRgb* palette, int rowBegin, int rowEnd);
+    void clear(QRgb color = qRgb(255, 255, 255));
+    QImage& canvas();                     // direct access for free-form drawing...
+    void invalidate(const QRect& rect);   // ...followed by marking what was touched
+    void flush();
+
+    // cells (row-major, bottom row first) must stay valid until the next
+    // showTiled() or showFramebuffer()
+    void showTiled(const uint8_t* cells, int cols, int rows, const QRgb* palette);
+    void showFramebuffer();
+    bool isTiled() const { return board != nullptr; }
+    void setCamera(int x, int y);         // board cell (centre-relative) to keep in the middle
+    int cachedTiles() const { return static_cast<int>(tiles.size()); }
+
+    // progress returns how far the latest tick is through, 0..1
+    void setProgressSource(std::function<double()> progress);
+    void setMotion(const BoardMotion& motion);
+
+signals:
+    void framePainted();
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+
+private:
+    static const int TileCells = 16; // tile edge, in cells
+    static const int MaxDirty = 16;  // rects queued between flushes before they merge
+
+    struct Tile {
+        QImage image;
+        uint64_t lastUsed = 0;
+    };
+
+    void ensureFrame();
+    void markDirty(const QRect& rect);
+    void markAllDirty();
+    void paintTiles(QPainter& painter, QPoint shift);
+    void paintSlides(QPainter& painter, double progress, QPoint shift);
+    QPoint viewOrigin(QPoint shift) const;
+    QRect viewRect(int x, int y, QPoint shift) const;
+    QRect motionRect(QPoint shift) const;
+    const QImage& tile(int tx, int ty);
+    void rasterize(QImage& image, int tx, int ty) const;
+    void evictTiles(size_t keep);
+
+    QImage frame;
+    QRect dirty[MaxDirty]; // fixed, so a tick's repaints never touch the heap
+    int dirtyCount = 0;
+    int cellSize = 15;
+
+    const uint8_t* board = nullptr; // set while tiled
+    int boardCols = 0;
+    int boardRows = 0;
+    const QRgb* boardPalette = nullptr;
+    int cameraX = 0;
+    int cameraY = 0;
+    std::unordered_map<int, Tile> tiles; // by tile row * tile columns + tile column
+    std::vector<QImage> spareTiles;      // evicted images, recycled for new tiles
+    uint64_t paints = 0;
+    bool tilesChanged = false;
+
+    BoardMotion motion;
+    std::function<double()> progressSource;
+};
+
+#endif // BOARDWIDGET_H
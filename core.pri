@@ -0,0 +1,79 @@
+# Everything except the main window: the engine, the widgets it draws
+# through, storage and tooling. Included by app.pro and the benchmarks.
+
+QT += core gui widgets concurrent network
+
+CONFIG += c++17
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+# Hot-path tracing (F9 exports a trace, F10 shows the overlay). Off unless
+# built with: qmake CONFIG+=tracing
+tracing: DEFINES += SNAKE_TRACING
+
+# Heap allocations counted per tick through a replaced malloc
+# (--alloc-check, and the tickAllocations benchmark). Off unless built with:
+# qmake CONFIG+=alloccount
+alloccount: DEFINES += SNAKE_ALLOC_COUNT
+
+# You can make your code fail to compile if it uses deprecated APIs.
+# In order to do so, uncomment the following line.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+SOURCES += \
+    $$PWD/alloccount.cpp \
+    $$PWD/arena.cpp \
+    $$PWD/arenaclient.cpp \
+    $$PWD/arenaprotocol.cpp \
+    $$PWD/arenaserver.cpp \
+    $$PWD/autopilot.cpp \
+    $$PWD/batchrunner.cpp \
+    $$PWD/boardwidget.cpp \
+    $$PWD/fixedstep.cpp \
+    $$PWD/frameexport.cpp \
+    $$PWD/gameengine.cpp \
+    $$PWD/highscorestore.cpp \
+    $$PWD/leaderboard.cpp \
+    $$PWD/level.cpp \
+    $$PWD/levelfiles.cpp \
+    $$PWD/levelgen.cpp \
+    $$PWD/levelsupply.cpp \
+    $$PWD/replay.cpp \
+    $$PWD/snapshot.cpp \
+    $$PWD/trace.cpp \
+    $$PWD/workpool.cpp
+
+HEADERS += \
+    $$PWD/alloccount.h \
+    $$PWD/arena.h \
+    $$PWD/arenaclient.h \
+    $$PWD/arenaprotocol.h \
+    $$PWD/arenaserver.h \
+    $$PWD/autopilot.h \
+    $$PWD/batchrunner.h \
+    $$PWD/boardwidget.h \
+    $$PWD/fixedstep.h \
+    $$PWD/frameexport.h \
+    $$PWD/freecells.h \
+    $$PWD/gameengine.h \
+    $$PWD/gametypes.h \
+    $$PWD/highscorestore.h \
+    $$PWD/inputqueue.h \
+    $$PWD/leaderboard.h \
+    $$PWD/level.h \
+    $$PWD/levelfiles.h \
+    $$PWD/levelgen.h \
+    $$PWD/levelsupply.h \
+    $$PWD/ranktree.h \
+    $$PWD/replay.h \
+    $$PWD/rng.h \
+    $$PWD/snakebody.h \
+    $$PWD/snapshot.h \
+    $$PWD/timerwheel.h \
+    $$PWD/trace.h \
+    $$PWD/varint.h \
+    $$PWD/workpool.h
+
+RESOURCES += \
+    $$PWD/levels.qrc
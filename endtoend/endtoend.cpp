@@ -0,0 +1,392 @@
+#include "boardwidget.h"
+#include "mainwindow.h"
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QRadioButton>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+// Board colours the harness reads back, as the game paints them
+static const QRgb SnakeColor = qRgb(0, 0, 0);
+static const QRgb EmptyColor = qRgb(255, 255, 255);
+static const QRgb FoodColor = qRgb(0, 0, 255);
+
+// Count, mean and spread of a set of times in milliseconds
+static QJsonObject summary(std::vector<double> ms) {
+    QJsonObject out;
+    out["count"] = static_cast<int>(ms.size());
+    if (ms.empty())
+        return out;
+    std::sort(ms.begin(), ms.end());
+    auto at = [&ms](double q) { return ms[std::min(ms.size() - 1, static_cast<size_t>(q * ms.size()))]; };
+    double total = 0;
+    for (double v : ms)
+        total += v;
+    out["meanMs"] = total / ms.size();
+    out["p50Ms"] = at(0.5);
+    out["p99Ms"] = at(0.99);
+    out["maxMs"] = ms.back();
+    return out;
+}
+
+static Qt::Key keyFor(Direction d) {
+    switch (d) {
+    case Direction::Right: return Qt::Key_Right;
+    case Direction::Left: return Qt::Key_Left;
+    case Direction::Up: return Qt::Key_Up;
+    default: return Qt::Key_Down;
+    }
+}
+
+struct HarnessSettings {
+    QString mode = "Mode_2"; // walled in, so a game ends once the steering stops
+    QString difficulty = "Hard";
+    int games = 3;
+    int turns = 20;          // scripted turns per game
+    int setupPauseMs = 500;  // from the new board to Enter, as a player would take
+};
+
+// Plays the real window through its own inputs: the New Game button, then
+// keys sent to the window. Every frame the board paints is grabbed and read
+// back, following the snake's head cell by cell, so a turn counts as shown
+// from the first frame with snake pixels in the cell it turned into.
+class Harness : public QObject
+{
+public:
+    Harness(MainWindow& window, const HarnessSettings& settings);
+    QJsonObject run();
+
+private:
+    bool playGame();
+    void onFramePainted();
+    void track(const QImage& image);
+    QRect cellRect(Cell cell) const;
+    Cell neighbour(Cell cell, Direction d, int steps = 1) const;
+    bool isFree(const QImage& image, Cell cell) const;
+    bool showsSnake(const QImage& image, Cell cell) const;
+    Direction pickTurn() const;
+    qint64 nowNs() const { return clock.nsecsElapsed(); }
+    void waitUntil(qint64 ns);
+
+    MainWindow& window;
+    HarnessSettings settings;
+    BoardWidget* board;
+    int tickMs;
+    int cellSize;
+    int cols = 0;
+    int rows = 0;
+    QElapsedTimer clock;
+
+    // What the latest grab shows
+    bool grabbing = false;
+    QImage shown;
+    Cell head;
+    Direction heading = Direction::Right;
+    qint64 headMoves = 0;
+    qint64 frames = 0;
+    qint64 lastFrameNs = -1;
+
+    // The turn waiting to show up
+    Direction pendingTurn = Direction::None;
+    qint64 pressNs = 0;
+
+    bool ended = false;
+    bool ranked = false;
+    qint64 endedNs = 0;
+    qint64 rankedNs = 0;
+
+    std::vector<double> newGameMs;
+    std::vector<double> firstFrameMs;
+    std::vector<double> keyToPixelMs;
+    std::vector<double> gameOverToLeaderboardMs;
+    int missed = 0;
+    int skipped = 0;
+    int unranked = 0;
+    qint64 playedNs = 0;
+    qint64 playedTicks = 0;
+    qint64 playedFrames = 0;
+};
+
+Harness::Harness(MainWindow& window, const HarnessSettings& settings)
+    : window(window)
+    , settings(settings)
+    , board(window.findChild<BoardWidget*>("workArea"))
+    , tickMs(settings.difficulty == "Easy" ? 85 : settings.difficulty == "Medium" ? 70 : 55) // as New Game sets them
+    , cellSize(board->cellSizePx())
+{
+    connect(board, &BoardWidget::framePainted, this, &Harness::onFramePainted);
+    connect(&window, &MainWindow::gameEnded, this, [this] {
+        ended = true;
+        endedNs = nowNs();
+    });
+    connect(&window, &MainWindow::highScoresUpdated, this, [this] {
+        ranked = true;
+        rankedNs = nowNs();
+    });
+    clock.start();
+}
+
+// Grabs what the board just painted. The grab paints it again, which is
+// not counted as a frame of its own.
+void Harness::onFramePainted() {
+    if (grabbing)
+        return;
+    const qint64 paintedNs = nowNs();
+    grabbing = true;
+    const QImage image = board->grab().toImage().convertToFormat(QImage::Format_RGB32);
+    grabbing = false;
+    ++frames;
+    lastFrameNs = paintedNs;
+    track(image);
+    shown = image;
+}
+
+// Matches the board's own layout: cell (0, 0) just up and right of the centre
+QRect Harness::cellRect(Cell cell) const {
+    return QRect(board->width() / 2 + cell.x * cellSize, board->height() / 2 - (cell.y + 1) * cellSize, cellSize,
+                 cellSize);
+}
+
+// The board wraps at its edges, as the snake does
+Cell Harness::neighbour(Cell cell, Direction d, int steps) const {
+    auto wrap = [](int v, int half) {
+        const int m = (v + half) % (2 * half);
+        return (m < 0 ? m + 2 * half : m) - half;
+    };
+    return { wrap(cell.x + directionX(d) * steps, cols / 2), wrap(cell.y + directionY(d) * steps, rows / 2) };
+}
+
+bool Harness::isFree(const QImage& image, Cell cell) const {
+    const QPoint centre = cellRect(cell).center();
+    if (!image.rect().contains(centre))
+        return false;
+    const QRgb pixel = image.pixel(centre);
+    return pixel == EmptyColor || pixel == FoodColor;
+}
+
+bool Harness::showsSnake(const QImage& image, Cell cell) const {
+    const QRect r = cellRect(cell).intersected(image.rect());
+    for (int y = r.top(); y <= r.bottom(); ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (int x = r.left(); x <= r.right(); ++x) {
+            if (line[x] == SnakeColor)
+                return true;
+        }
+    }
+    return false;
+}
+
+// Follows the head: a cell ahead or to either side whose centre has just
+// turned to snake. The pending turn is shown once the cell it leads into
+// has any snake pixel, which with the drawing between ticks is well before
+// the head gets there.
+void Harness::track(const QImage& image) {
+    if (shown.isNull() || image.size() != shown.size())
+        return;
+    if (pendingTurn != Direction::None && showsSnake(image, neighbour(head, pendingTurn))) {
+        keyToPixelMs.push_back((lastFrameNs - pressNs) / 1e6);
+        pendingTurn = Direction::None;
+    }
+    for (int move = 0; move < 2; ++move) { // two cells a tick at double speed
+        bool moved = false;
+        for (Direction d : { Direction::Right, Direction::Left, Direction::Up, Direction::Down }) {
+            if (isReversal(d, heading))
+                continue;
+            const Cell next = neighbour(head, d);
+            const QPoint centre = cellRect(next).center();
+            if (image.pixel(centre) == SnakeColor && shown.pixel(centre) != SnakeColor) {
+                head = next;
+                heading = d;
+                ++headMoves;
+                moved = true;
+                break;
+            }
+        }
+        if (!moved)
+            break;
+    }
+}
+
+// A turn to either side with room to carry on, so the game outlasts the script
+Direction Harness::pickTurn() const {
+    const Direction sides[2][2] = { { Direction::Up, Direction::Down }, { Direction::Right, Direction::Left } };
+    const bool horizontal = directionX(heading) != 0;
+    for (Direction d : sides[horizontal ? 0 : 1]) {
+        bool room = true;
+        // The snake may still take a step ahead before the turn lands
+        for (Cell from : { head, neighbour(head, heading) }) {
+            for (int k = 1; k <= 4 && room; ++k)
+                room = isFree(shown, neighbour(from, d, k));
+        }
+        if (room)
+            return d;
+    }
+    return Direction::None;
+}
+
+void Harness::waitUntil(qint64 ns) {
+    const int timeoutMs = static_cast<int>(std::max<qint64>(0, ns - nowNs()) / 1000000) + 1000;
+    QTest::qWaitFor([&] { return ended || nowNs() >= ns; }, timeoutMs);
+}
+
+bool Harness::playGame() {
+    ended = false;
+    ranked = false;
+    pendingTurn = Direction::None;
+
+    // Level setup: the click handled, and the first frame of the new board
+    QPushButton* newGame = window.findChild<QPushButton*>("New_Game");
+    const qint64 framesBefore = frames;
+    const qint64 clickNs = nowNs();
+    QTest::mouseClick(newGame, Qt::LeftButton);
+    newGameMs.push_back((nowNs() - clickNs) / 1e6);
+    if (!QTest::qWaitFor([&] { return frames > framesBefore; }, 5000))
+        return false;
+    firstFrameMs.push_back((lastFrameNs - clickNs) / 1e6);
+    QTest::qWait(settings.setupPauseMs);
+
+    cols = 2 * (board->width() / (2 * cellSize));
+    rows = 2 * (board->height() / (2 * cellSize));
+    head = { 2, 0 };
+    heading = Direction::Right;
+    QTest::keyClick(&window, Qt::Key_Return);
+    const qint64 startNs = nowNs();
+    const qint64 startMoves = headMoves;
+    const qint64 startFrames = frames;
+
+    // Turns a few ticks apart, each landing at a different point in its tick
+    const qint64 periodNs = 4LL * tickMs * 1000000;
+    for (int i = 0; i < settings.turns && !ended; ++i) {
+        waitUntil(startNs + (i + 1) * periodNs + (i * 37 % 100) * tickMs * 10000LL);
+        if (ended)
+            break;
+        const Direction turn = pickTurn();
+        if (turn == Direction::None) {
+            ++skipped;
+            continue;
+        }
+        pendingTurn = turn;
+        pressNs = nowNs();
+        QTest::keyClick(&window, keyFor(turn));
+        QTest::qWaitFor([&] { return ended || pendingTurn == Direction::None; }, 10 * tickMs);
+        if (pendingTurn != Direction::None && !ended)
+            ++missed;
+        pendingTurn = Direction::None;
+    }
+    playedNs += (ended ? endedNs : nowNs()) - startNs;
+    playedTicks += headMoves - startMoves;
+    playedFrames += frames - startFrames;
+
+    // No more steering: the snake runs into the walls
+    if (!QTest::qWaitFor([&] { return ended; }, 2 * (cols + rows) * tickMs + 5000))
+        return false;
+    if (QTest::qWaitFor([&] { return ranked; }, 5000))
+        gameOverToLeaderboardMs.push_back((rankedNs - endedNs) / 1e6);
+    else
+        ++unranked;
+    return true;
+}
+
+QJsonObject Harness::run() {
+    window.findChild<QLineEdit*>("nameInput")->setText("Harness");
+    for (const QString& name : { settings.mode, settings.difficulty }) {
+        if (QRadioButton* button = window.findChild<QRadioButton*>(name))
+            button->setChecked(true);
+    }
+
+    int played = 0;
+    for (int game = 0; game < settings.games; ++game)
+        played += playGame();
+
+    QJsonObject keyToPixel = summary(keyToPixelMs);
+    keyToPixel["missed"] = missed;
+    keyToPixel["skipped"] = skipped;
+    QJsonObject leaderboard = summary(gameOverToLeaderboardMs);
+    leaderboard["unranked"] = unranked;
+    QJsonObject setup;
+    setup["newGame"] = summary(newGameMs);
+    setup["firstFrame"] = summary(firstFrameMs);
+    QJsonObject ticks;
+    const double seconds = playedNs / 1e9;
+    ticks["seconds"] = seconds;
+    ticks["ticksPerSecond"] = seconds > 0 ? playedTicks / seconds : 0.0;
+    ticks["expectedTicksPerSecond"] = 1000.0 / tickMs;
+    ticks["framesPerSecond"] = seconds > 0 ? playedFrames / seconds : 0.0;
+
+    QJsonObject out;
+    out["platform"] = QGuiApplication::platformName();
+    out["mode"] = settings.mode;
+    out["difficulty"] = settings.difficulty;
+    out["tickMs"] = tickMs;
+    out["games"] = settings.games;
+    out["gamesPlayed"] = played;
+    out["levelSetup"] = setup;
+    out["keyToPixel"] = keyToPixel;
+    out["gameOverToLeaderboard"] = leaderboard;
+    out["tickRate"] = ticks;
+    return out;
+}
+
+int main(int argc, char* argv[]) {
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption mode("mode", "Level to play; it needs walls for games to end (default Mode_2).", "name", "Mode_2");
+    QCommandLineOption difficulty("difficulty", "Easy, Medium or Hard (default Hard).", "name", "Hard");
+    QCommandLineOption games("games", "Games to play (default 3).", "count", "3");
+    QCommandLineOption turns("turns", "Scripted turns per game (default 20).", "count", "20");
+    QCommandLineOption out("out", "JSON file for the results (default stdout).", "file");
+    parser.addOptions({ mode, difficulty, games, turns, out });
+    parser.process(app);
+
+    HarnessSettings settings;
+    settings.mode = parser.value(mode);
+    settings.difficulty = parser.value(difficulty);
+    settings.games = std::max(1, parser.value(games).toInt());
+    settings.turns = std::max(0, parser.value(turns).toInt());
+    // Relative to where we were started, not the directory below
+    const QString outPath = parser.isSet(out) ? QFileInfo(parser.value(out)).absoluteFilePath() : QString();
+
+    // High scores, replays and the resume file go somewhere disposable
+    QTemporaryDir dir;
+    if (!dir.isValid() || !QDir::setCurrent(dir.path())) {
+        std::fprintf(stderr, "Cannot make a working directory\n");
+        return 1;
+    }
+
+    MainWindow window;
+    window.show();
+    if (!QTest::qWaitForWindowExposed(&window)) {
+        std::fprintf(stderr, "The window never showed\n");
+        return 1;
+    }
+    Harness harness(window, settings);
+    const QJsonObject results = harness.run();
+    const QByteArray json = QJsonDocument(results).toJson();
+
+    if (!outPath.isEmpty()) {
+        QFile file(outPath);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size()) {
+            std::fprintf(stderr, "Cannot write %s\n", qPrintable(outPath));
+            return 1;
+        }
+    }
+    else {
+        std::fwrite(json.constData(), 1, static_cast<size_t>(json.size()), stdout);
+    }
+    return results["gamesPlayed"].toInt() == settings.games ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+# End-to-end harness: the real game window on the offscreen platform, played
+# through the New Game button and scripted keys. Reports key-to-pixel
+# latency, level setup, game over to leaderboard time and the sustained tick
+# rate as JSON, for diffing between revisions, e.g.
+#   ./endtoend --games 5 --out e2e.json
+TARGET = endtoend
+TEMPLATE = app
+
+QT += testlib
+CONFIG += console
+CONFIG -= app_bundle
+
+include(../core.pri)
+
+SOURCES += \
+    endtoend.cpp \
+    ../mainwindow.cpp
+
+HEADERS += \
+    ../mainwindow.h
+
+FORMS += \
+    ../mainwindow.ui
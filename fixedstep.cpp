@@ -0,0 +1,41 @@
+#include "fixedstep.h"
+#include <algorithm>
+
+void FixedStepClock::start(int64_t nowNs, int64_t stepNs, int maxCatchUp) {
+    origin = nowNs;
+    step = std::max<int64_t>(stepNs, 1);
+    tickCount = 0;
+    catchUpLimit = std::max(maxCatchUp, 1);
+    tickStats = TickStats();
+}
+
+int FixedStepClock::advance(int64_t nowNs) {
+    const int64_t deadline = nextDeadlineNs();
+    if (nowNs < deadline)
+        return 0;
+
+    const int64_t lateness = nowNs - deadline;
+    int64_t due = lateness / step + 1;
+    if (due > 1)
+        ++tickStats.missed;
+    tickStats.maxJitterNs = std::max(tickStats.maxJitterNs, lateness);
+
+    if (due > catchUpLimit) {
+        // Give up on the backlog: shift the origin so the next deadline
+        // is one step after the last step we do run.
+        tickStats.dropped += due - catchUpLimit;
+        origin += (due - catchUpLimit) * step;
+        due = catchUpLimit;
+    }
+
+    ++tickStats.wakeups;
+    tickStats.totalJitterNs += lateness;
+    tickStats.ticks += due;
+    tickCount += due;
+    return static_cast<int>(due);
+}
+
+double FixedStepClock::alpha(int64_t nowNs) const {
+    const double a = static_cast<double>(nowNs - origin - tickCount * step) / step;
+    return std::clamp(a, 0.0, 1.0);
+}
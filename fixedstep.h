@@ -0,0 +1,44 @@
+#ifndef FIXEDSTEP_H
+#define FIXEDSTEP_H
+
+#include <cstdint>
+
+struct TickStats {
+    int64_t ticks = 0;          // simulation steps run
+    int64_t wakeups = 0;        // advance() calls that ran at least one step
+    int64_t missed = 0;         // wake-ups that came a whole step or more late
+    int64_t dropped = 0;        // steps skipped by the catch-up cap
+    int64_t maxJitterNs = 0;    // worst lateness of a wake-up against its deadline
+    int64_t totalJitterNs = 0;
+
+    double meanJitterMs() const { return wakeups ? totalJitterNs / 1e6 / wakeups : 0.0; }
+};
+
+// Fixed-timestep scheduler. Deadlines are absolute (origin + n * step) on the
+// caller's monotonic clock, so late wake-ups never accumulate drift: the
+// steps that fell due are run back to back, at most maxCatchUp at a time,
+// and anything beyond that is dropped rather than spiralling.
+class FixedStepClock
+{
+public:
+    void start(int64_t nowNs, int64_t stepNs, int maxCatchUp = 5);
+
+    // Steps due at nowNs; the caller must run exactly that many.
+    int advance(int64_t nowNs);
+
+    int64_t stepNs() const { return step; }
+    int64_t ticks() const { return tickCount; }
+    int64_t simulatedMs() const { return tickCount * step / 1000000; }
+    int64_t nextDeadlineNs() const { return origin + (tickCount + 1) * step; }
+    double alpha(int64_t nowNs) const; // progress towards the next step, 0..1
+    const TickStats& stats() const { return tickStats; }
+
+private:
+    int64_t origin = 0;
+    int64_t step = 1;
+    int64_t tickCount = 0;
+    int catchUpLimit = 5;
+    TickStats tickStats;
+};
+
+#endif // FIXEDSTEP_H
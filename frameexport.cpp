@@ -0,0 +1,249 @@
+#include "frameexport.h"
+#include "workpool.h"
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// Board colours, indexed by CellKind, as in the game
+const QRgb cellPalette[] = {
+    qRgb(255, 255, 255),
+    qRgb(0, 0, 0),
+    qRgb(0, 0, 255),
+    qRgb(255, 0, 0),
+    qRgb(255, 140, 0),
+    qRgb(0, 160, 0),
+};
+
+struct EncodedFrame {
+    int64_t index = 0;
+    QByteArray data;
+};
+
+// Producers block while it is full, the consumer while it is empty
+class FrameQueue
+{
+public:
+    explicit FrameQueue(size_t capacity) : capacity(capacity) {}
+
+    void push(EncodedFrame frame) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return frames.size() < capacity; });
+        frames.push_back(std::move(frame));
+        peak = std::max(peak, frames.size());
+        notEmpty.notify_one();
+    }
+
+    // false once closed and drained
+    bool pop(EncodedFrame& frame) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return !frames.empty() || closed; });
+        if (frames.empty())
+            return false;
+        frame = std::move(frames.front());
+        frames.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+    }
+
+    size_t peakSize() const { return peak; }
+
+private:
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    std::deque<EncodedFrame> frames;
+    size_t capacity;
+    size_t peak = 0;
+    bool closed = false;
+};
+
+// A stretch of the game, a few chunks long: the board at the start of each
+// chunk plus the cell changes of every tick in between
+struct Window {
+    int64_t firstFrame = 0;
+    int64_t frames = 0;
+    std::vector<std::vector<CellKind>> starts;
+    std::vector<CellChange> changes;
+    std::vector<size_t> changeBegin; // by frame in the window: end of the changes that lead to it
+};
+
+// Steps the replay one window at a time, so only the stretch being drawn
+// and the one after it are ever held, however long the game is
+class WindowSimulator
+{
+public:
+    bool reset(const Replay& replay) {
+        if (!player.reset(replay))
+            return false;
+        tickLimit = replay.claimedTicks > 0 ? replay.claimedTicks : 10000000;
+        frame = 0;
+        return true;
+    }
+
+    int columns() const { return player.game().columns(); }
+    int rows() const { return player.game().rows(); }
+
+    // The next chunks * chunkFrames frames, fewer at the end of the game;
+    // false once there are none left
+    bool next(int chunks, int chunkFrames, Window& out) {
+        out = Window();
+        out.firstFrame = frame;
+        const GameEngine& game = player.game();
+        const size_t cells = static_cast<size_t>(game.columns()) * game.rows();
+        for (int64_t k = 0; k < static_cast<int64_t>(chunks) * chunkFrames; ++k) {
+            if (frame > 0) { // every frame after the starting board is one step on
+                if (player.finished() || player.tick() >= tickLimit)
+                    break;
+                const StepResult& result = player.step();
+                if (k > 0)
+                    out.changes.insert(out.changes.end(), result.changes.begin(), result.changes.end());
+            }
+            if (k % chunkFrames == 0)
+                out.starts.emplace_back(game.cells(), game.cells() + cells);
+            out.changeBegin.push_back(out.changes.size());
+            ++out.frames;
+            ++frame;
+        }
+        return out.frames > 0;
+    }
+
+private:
+    ReplayPlayer player;
+    uint32_t tickLimit = 0;
+    int64_t frame = 0;
+};
+
+void fillCell(QImage& image, int col, int topRow, int cellSize, QRgb color) {
+    for (int y = topRow * cellSize; y < (topRow + 1) * cellSize; ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y)) + col * cellSize;
+        std::fill(line, line + cellSize, color);
+    }
+}
+
+void rasterize(QImage& image, const std::vector<CellKind>& cells, int cols, int rows, int cellSize) {
+    for (int row = 0; row < rows; ++row)
+        for (int col = 0; col < cols; ++col)
+            fillCell(image, col, rows - 1 - row, cellSize,
+                     cellPalette[static_cast<int>(cells[static_cast<size_t>(row) * cols + col])]);
+}
+
+QByteArray encode(const QImage& image, FrameFormat format) {
+    if (format == FrameFormat::Rgba) {
+        const QImage rgba = image.convertToFormat(QImage::Format_RGBA8888);
+        return QByteArray(reinterpret_cast<const char*>(rgba.constBits()), static_cast<int>(rgba.sizeInBytes()));
+    }
+    QByteArray png;
+    QBuffer buffer(&png);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    return png;
+}
+
+} // namespace
+
+FrameExportResult exportReplayFrames(const Replay& replay, const FrameExportSettings& settings) {
+    FrameExportResult result;
+    const auto begin = std::chrono::steady_clock::now();
+    const int chunkFrames = std::max(1, settings.chunkFrames);
+    const int cellSize = std::max(1, settings.cellSize);
+
+    WindowSimulator game;
+    if (!game.reset(replay)) {
+        result.error = "the replay does not describe a valid game";
+        return result;
+    }
+    const int cols = game.columns();
+    const int rows = game.rows();
+    result.width = cols * cellSize;
+    result.height = rows * cellSize;
+
+    if (!QDir().mkpath(settings.directory)) {
+        result.error = "cannot create " + settings.directory;
+        return result;
+    }
+    QFile raw(QDir(settings.directory).filePath("frames.rgba"));
+    if (settings.format == FrameFormat::Rgba && !raw.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        result.error = "cannot write " + raw.fileName();
+        return result;
+    }
+
+    WorkStealingPool pool(settings.threads);
+    result.threads = pool.threadCount();
+    FrameQueue queue(static_cast<size_t>(settings.queueFrames > 0 ? settings.queueFrames : 4 * pool.threadCount()));
+
+    // Frames reach the writer in any order; each has its own file, or its
+    // own slot in the raw stream, so none has to wait for another
+    bool writeFailed = false;
+    std::thread writer([&] {
+        const int64_t frameBytes = static_cast<int64_t>(result.width) * result.height * 4;
+        EncodedFrame frame;
+        while (queue.pop(frame)) {
+            if (writeFailed)
+                continue;
+            if (settings.format == FrameFormat::Rgba) {
+                writeFailed = !raw.seek(frame.index * frameBytes) || raw.write(frame.data) != frame.data.size();
+            }
+            else {
+                QFile file(QDir(settings.directory).filePath(QString("frame-%1.png").arg(frame.index, 6, 10, QChar('0'))));
+                writeFailed = !file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(frame.data) != frame.data.size();
+            }
+            result.bytes += frame.data.size();
+        }
+    });
+
+    // The next window is simulated while the workers draw this one
+    const int windowChunks = 2 * pool.threadCount();
+    std::vector<QImage> canvases(static_cast<size_t>(pool.threadCount()));
+    Window current;
+    bool more = game.next(windowChunks, chunkFrames, current);
+    while (more) {
+        Window ahead;
+        std::thread simulator([&] { more = game.next(windowChunks, chunkFrames, ahead); });
+        pool.run(current.starts.size(), [&](size_t chunk, int worker) {
+            QImage& image = canvases[static_cast<size_t>(worker)];
+            if (image.isNull())
+                image = QImage(result.width, result.height, QImage::Format_RGB32);
+            rasterize(image, current.starts[chunk], cols, rows, cellSize);
+
+            const int64_t first = static_cast<int64_t>(chunk) * chunkFrames;
+            const int64_t last = std::min(current.frames, first + chunkFrames);
+            for (int64_t frame = first; frame < last; ++frame) {
+                if (frame > first) {
+                    for (size_t i = current.changeBegin[frame - 1]; i < current.changeBegin[frame]; ++i) {
+                        const CellChange& change = current.changes[i];
+                        fillCell(image, change.cell.x + cols / 2, rows / 2 - 1 - change.cell.y, cellSize,
+                                 cellPalette[static_cast<int>(change.kind)]);
+                    }
+                }
+                queue.push({ current.firstFrame + frame, encode(image, settings.format) });
+            }
+        });
+        simulator.join();
+        result.frames += current.frames;
+        current = std::move(ahead);
+    }
+    queue.close();
+    writer.join();
+
+    result.peakQueued = static_cast<int>(queue.peakSize());
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    result.ok = !writeFailed;
+    if (writeFailed)
+        result.error = "writing to " + settings.directory + " failed";
+    return result;
+}
@@ -0,0 +1,43 @@
+#ifndef FRAMEEXPORT_H
+#define FRAMEEXPORT_H
+
+#include "replay.h"
+#include <QString>
+#include <cstdint>
+
+enum class FrameFormat {
+    Png,    // one frame-NNNNNN.png per tick
+    Rgba    // every frame back to back in frames.rgba, RGBA8888, no header
+};
+
+struct FrameExportSettings {
+    QString directory;
+    FrameFormat format = FrameFormat::Png;
+    int cellSize = 15;          // pixels per board cell
+    int threads = 0;            // 0 = one per hardware thread
+    int chunkFrames = 32;       // frames rendered in a row by one worker
+    int queueFrames = 0;        // encoded frames allowed to wait for the writer; 0 = 4 per thread
+};
+
+struct FrameExportResult {
+    bool ok = false;
+    QString error;
+    int64_t frames = 0;
+    int width = 0;
+    int height = 0;
+    int threads = 0;
+    int64_t bytes = 0;          // written to disk
+    int peakQueued = 0;         // most encoded frames ever waiting at once
+    double seconds = 0;
+};
+
+// Renders a recorded game to images without a window, one frame per tick
+// from the starting board to the last step. The game is simulated a window
+// of chunks at a time, keeping the board at the start of every chunk and the
+// cell changes in between, one window ahead of the workers that rasterise
+// and encode the chunks on every core. A single writer thread streams the
+// results to disk through a bounded queue, so memory stays flat however
+// long the game is.
+FrameExportResult exportReplayFrames(const Replay& replay, const FrameExportSettings& settings);
+
+#endif // FRAMEEXPORT_H
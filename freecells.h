@@ -0,0 +1,82 @@
+#ifndef FREECELLS_H
+#define FREECELLS_H
+
+#include <vector>
+
+// Set of free board cells (by grid index) with O(1) insert, erase and uniform
+// sampling: the free cells are kept packed in a dense array and every cell
+// remembers its slot there, so erase swaps the last element into the hole.
+class FreeCells
+{
+public:
+    void reset(int cellCount) {
+        dense.resize(cellCount);
+        slot.resize(cellCount);
+        for (int i = 0; i < cellCount; ++i) {
+            dense[i] = i;
+            slot[i] = i;
+        }
+        count = cellCount;
+    }
+
+    // Starts from the free cells listed in order, every other cell taken;
+    // fails if a cell is out of range or listed twice
+    bool assign(int cellCount, const std::vector<int>& order) {
+        dense.assign(cellCount, -1);
+        slot.assign(cellCount, cellCount);
+        count = 0;
+        for (int cell : order) {
+            if (cell < 0 || cell >= cellCount || slot[cell] != cellCount)
+                return false;
+            dense[count] = cell;
+            slot[cell] = count++;
+        }
+        int next = count;
+        for (int cell = 0; cell < cellCount; ++cell) {
+            if (slot[cell] == cellCount) {
+                dense[next] = cell;
+                slot[cell] = next++;
+            }
+        }
+        return true;
+    }
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool contains(int cell) const { return slot[cell] < count; }
+
+    void insert(int cell) {
+        if (contains(cell))
+            return;
+        swapSlots(slot[cell], count);
+        ++count;
+    }
+
+    void erase(int cell) {
+        if (!contains(cell))
+            return;
+        --count;
+        swapSlots(slot[cell], count);
+    }
+
+    // Free cell at position i of the packed array, for i in [0, size())
+    int at(int i) const { return dense[i]; }
+
+private:
+    // The array always holds every cell; the first `count` entries are the free
+    // ones, so moving a cell in or out is a swap across that boundary.
+    void swapSlots(int a, int b) {
+        const int cellA = dense[a];
+        const int cellB = dense[b];
+        dense[a] = cellB;
+        dense[b] = cellA;
+        slot[cellB] = a;
+        slot[cellA] = b;
+    }
+
+    std::vector<int> dense;
+    std::vector<int> slot;
+    int count = 0;
+};
+
+#endif // FREECELLS_H
@@ -0,0 +1,392 @@
+#include "gameengine.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstring>
+
+GameEngine::GameEngine(const GameConfig& config)
+{
+    reset(config);
+}
+
+void GameEngine::reset(const GameConfig& config) {
+    cfg = config;
+    rng.reseed(cfg.seed);
+    result = StepResult();
+    cols = 2 * cfg.halfCols;
+    rowCount = 2 * cfg.halfRows;
+    grid.assign(static_cast<size_t>(cols) * rowCount, CellKind::Empty);
+    freeCells.reset(cols * rowCount);
+    body.reset(cols * rowCount);
+    heading = Direction::None;
+    foodPlaced = false;
+    foodTimer = TimerId();
+    bombCells.clear();
+    cooling = 0;
+    powerUpPlaced = false;
+    powerKind = PowerUp::None;
+    powerUpTimer = TimerId();
+    speedTimer = TimerId();
+    timers.reset();
+    points = 0;
+    over = false;
+
+    // Sized for the busiest tick and the most timers the rules allow at
+    // once (a bomb's fuse, or its alert and cooldown, plus food, power-up
+    // and speed), so a running game never allocates
+    const int bombs = std::max(cfg.rules.maxBombs, 0);
+    result.changes.reserve(static_cast<size_t>(8 + 2 * bombs + std::max(cfg.rules.shrinkCells, 0)));
+    bombCells.reserve(static_cast<size_t>(bombs));
+    timers.reserve(static_cast<size_t>(3 * bombs + 3));
+
+    if (cfg.level)
+        stampLevel(*cfg.level);
+
+    for (int i = -2; i < 3; i++) {
+        body.pushHead({ i, 0 });
+        set({ i, 0 }, CellKind::Snake);
+    }
+}
+
+void GameEngine::start() {
+    if (heading == Direction::None && !over)
+        heading = Direction::Right;
+}
+
+EngineState GameEngine::state() const {
+    EngineState saved;
+    saved.heading = heading;
+    saved.points = points;
+    saved.over = over;
+    saved.foodPlaced = foodPlaced;
+    saved.food = foodCell;
+    saved.bombs = bombCells;
+    saved.powerUpPlaced = powerUpPlaced;
+    saved.powerUp = powerUpCell;
+    saved.powerUpKind = powerKind;
+    saved.clock = timers.now();
+    saved.timers = timers.pendingTimers();
+    rng.getState(saved.rng);
+    saved.body.reserve(body.size());
+    for (const Cell& c : body)
+        saved.body.push_back(c);
+    saved.freeOrder.resize(freeCells.size());
+    for (int i = 0; i < freeCells.size(); ++i)
+        saved.freeOrder[i] = freeCells.at(i);
+    return saved;
+}
+
+bool GameEngine::restore(const GameConfig& config, const EngineState& saved) {
+    reset(config);
+    while (body.size() > 0) {
+        grid[index(body.tail())] = CellKind::Empty;
+        body.popTail();
+    }
+
+    // Lay out the pieces on the grid alone; the free-cell set comes last, in
+    // the saved order
+    auto place = [this](Cell c, CellKind kind) {
+        if (!contains(c) || cellAt(c) != CellKind::Empty)
+            return false;
+        grid[index(c)] = kind;
+        return true;
+    };
+    bool ok = !saved.body.empty();
+    for (size_t i = 0; i < saved.body.size() && ok; ++i) {
+        ok = place(saved.body[i], CellKind::Snake);
+        body.pushHead(saved.body[i]);
+    }
+    if (ok && saved.foodPlaced)
+        ok = place(saved.food, CellKind::Food);
+    for (size_t i = 0; i < saved.bombs.size() && ok; ++i)
+        ok = place(saved.bombs[i], CellKind::Bomb);
+    if (ok && saved.powerUpPlaced)
+        ok = saved.powerUpKind != PowerUp::None && place(saved.powerUp, CellKind::PowerUp);
+    if (ok) {
+        const size_t empty = static_cast<size_t>(std::count(grid.begin(), grid.end(), CellKind::Empty));
+        ok = saved.freeOrder.size() == empty && freeCells.assign(cols * rowCount, saved.freeOrder);
+        for (size_t i = 0; i < saved.freeOrder.size() && ok; ++i)
+            ok = grid[saved.freeOrder[i]] == CellKind::Empty;
+    }
+
+    // The timers go back in firing order; each must belong to something on
+    // the board
+    timers.reset(saved.clock);
+    size_t fuses = 0;
+    for (size_t i = 0; i < saved.timers.size() && ok; ++i) {
+        const int64_t due = saved.timers[i].first;
+        const GameTimer& timer = saved.timers[i].second;
+        const TimerId id = timers.schedule(due, timer);
+        switch (timer.event) {
+        case TimedEvent::BombDiffuse:
+            ok = std::find(saved.bombs.begin(), saved.bombs.end(), timer.cell) != saved.bombs.end();
+            ++fuses;
+            break;
+        case TimedEvent::BombCooldownEnd:
+            ++cooling;
+            break;
+        case TimedEvent::FoodExpire:
+            ok = saved.foodPlaced && timer.cell == saved.food;
+            foodTimer = id;
+            break;
+        case TimedEvent::PowerUpExpire:
+            ok = saved.powerUpPlaced && timer.cell == saved.powerUp;
+            powerUpTimer = id;
+            break;
+        case TimedEvent::SpeedEnd:
+            speedTimer = id;
+            break;
+        case TimedEvent::BombAlertClear:
+            break;
+        default:
+            ok = false;
+        }
+    }
+    if (!ok || fuses != saved.bombs.size()) {
+        reset(config);
+        return false;
+    }
+
+    heading = saved.heading;
+    points = saved.points;
+    over = saved.over;
+    foodPlaced = saved.foodPlaced;
+    foodCell = saved.food;
+    bombCells = saved.bombs;
+    powerUpPlaced = saved.powerUpPlaced;
+    powerUpCell = saved.powerUp;
+    powerKind = saved.powerUpKind;
+    rng.setState(saved.rng);
+    return true;
+}
+
+// Marks x0..x1 (inclusive) of row y as wall with one contiguous byte fill.
+// Spans are clipped to the board so small windows still get a valid layout.
+void GameEngine::wallSpan(int y, int x0, int x1) {
+    if (y < -cfg.halfRows || y >= cfg.halfRows)
+        return;
+    x0 = std::max(x0, -cfg.halfCols);
+    x1 = std::min(x1, cfg.halfCols - 1);
+    if (x0 > x1)
+        return;
+
+    const int first = index({ x0, y });
+    for (int i = first; i <= first + x1 - x0; ++i)
+        freeCells.erase(i);
+    std::memset(grid.data() + first, static_cast<int>(CellKind::Wall), static_cast<size_t>(x1 - x0 + 1));
+}
+
+// Lays the level's walls onto the board in one pass, one span per run of walls
+void GameEngine::stampLevel(const Level& level) {
+    const int left = -level.cols / 2;
+    const int top = level.rows / 2 - 1;
+    for (int row = 0; row < level.rows; ++row) {
+        for (int col = 0; col < level.cols;) {
+            if (!level.wallAt(col, row)) {
+                ++col;
+                continue;
+            }
+            int end = col;
+            while (end + 1 < level.cols && level.wallAt(end + 1, row))
+                ++end;
+            wallSpan(top - row, left + col, left + end);
+            col = end + 1;
+        }
+    }
+}
+
+// Uniform pick among the free cells; false when the board is full
+bool GameEngine::randomFreeCell(Cell& out) {
+    if (freeCells.empty())
+        return false;
+    out = cellAtIndex(freeCells.at(static_cast<int>(rng.bounded(freeCells.size()))));
+    return true;
+}
+
+bool GameEngine::growFood(int64_t nowMs) {
+    TRACE_SCOPE("GameEngine::growFood");
+    Cell c;
+    if (!randomFreeCell(c))
+        return false;
+
+    foodCell = c;
+    foodPlaced = true;
+    set(c, CellKind::Food);
+    paint(c, CellKind::Food);
+    foodTimer = scheduleFoodExpiry(timers, cfg, c, nowMs);
+    return true;
+}
+
+void GameEngine::plantBomb(int64_t nowMs) {
+    TRACE_SCOPE("GameEngine::plantBomb");
+    Cell c;
+    if (!randomFreeCell(c))
+        return;
+
+    bombCells.push_back(c);
+    set(c, CellKind::Bomb);
+    result.bombPlanted = true;
+    paint(c, CellKind::Bomb);
+    scheduleFuse(timers, cfg, c, nowMs);
+}
+
+void GameEngine::placePowerUp(int64_t nowMs) {
+    if (rng.uniform() > cfg.rules.powerUpProbability)
+        return;
+
+    Cell c;
+    if (!randomFreeCell(c))
+        return;
+
+    powerUpCell = c;
+    powerUpPlaced = true;
+    powerKind = rng.bounded(2) ? PowerUp::Shrink : PowerUp::Speed;
+    set(c, CellKind::PowerUp);
+    paint(c, CellKind::PowerUp);
+    powerUpTimer = timers.schedule(nowMs + cfg.rules.powerUpLifetimeMs, { TimedEvent::PowerUpExpire, c, nowMs });
+}
+
+// The head has just moved onto the power-up
+void GameEngine::takePowerUp(int64_t nowMs) {
+    timers.cancel(powerUpTimer);
+    powerUpPlaced = false;
+    result.poweredUp = powerKind;
+    if (powerKind == PowerUp::Speed) {
+        // Taking another one while speeding starts the time again
+        timers.cancel(speedTimer);
+        speedTimer = timers.schedule(nowMs + cfg.rules.speedMs, { TimedEvent::SpeedEnd, powerUpCell, nowMs });
+    }
+    else {
+        for (int i = 0; i < cfg.rules.shrinkCells && body.size() > 2; ++i) {
+            const Cell tail = body.tail();
+            body.popTail();
+            set(tail, CellKind::Empty);
+            paint(tail, CellKind::Empty);
+        }
+    }
+    powerKind = PowerUp::None;
+}
+
+// Spawns and despawns as timers come due, in the order they come due
+void GameEngine::expire(const GameTimer& timer, int64_t nowMs) {
+    switch (timer.event) {
+    case TimedEvent::BombDiffuse:
+        bombCells.erase(std::find(bombCells.begin(), bombCells.end(), timer.cell));
+        set(timer.cell, CellKind::Empty);
+        paint(timer.cell, CellKind::Empty);
+        result.bombDiffused = true;
+        ++cooling;
+        scheduleCooldown(timers, cfg, timer);
+        break;
+    case TimedEvent::BombAlertClear:
+        result.bombAlertCleared = true;
+        break;
+    case TimedEvent::BombCooldownEnd:
+        --cooling;
+        break;
+    case TimedEvent::FoodExpire: {
+        // The new food is drawn before the old cell frees up, so it moves
+        const Cell old = foodCell;
+        if (growFood(nowMs)) {
+            set(old, CellKind::Empty);
+            paint(old, CellKind::Empty);
+        }
+        break;
+    }
+    case TimedEvent::PowerUpExpire:
+        set(timer.cell, CellKind::Empty);
+        paint(timer.cell, CellKind::Empty);
+        powerUpPlaced = false;
+        powerKind = PowerUp::None;
+        break;
+    case TimedEvent::SpeedEnd:
+        break;
+    }
+}
+
+void GameEngine::endGame(bool boardFull, CellKind hit) {
+    heading = Direction::None;
+    over = true;
+    result.gameOver = true;
+    result.boardFull = boardFull;
+    result.collision = hit;
+}
+
+const StepResult& GameEngine::step(const StepInput& input) {
+    TRACE_SCOPE("GameEngine::step");
+    result.moved = false;
+    result.ateFood = false;
+    result.gameOver = false;
+    result.boardFull = false;
+    result.collision = CellKind::Empty;
+    result.bombPlanted = false;
+    result.bombDiffused = false;
+    result.bombAlertCleared = false;
+    result.poweredUp = PowerUp::None;
+    result.changes.clear();
+
+    if (heading == Direction::None || over)
+        return result;
+
+    if (input.turn != Direction::None && !isReversal(input.turn, heading))
+        heading = input.turn;
+
+    if (!foodPlaced && !growFood(input.nowMs)) {
+        endGame(true);
+        return result;
+    }
+
+    if (rollBomb(cfg, bombCells.size(), cooling, rng))
+        plantBomb(input.nowMs);
+    if (cfg.rules.powerUpProbability > 0 && !powerUpPlaced)
+        placePowerUp(input.nowMs);
+
+    // Speed counts from the tick after it was taken
+    const bool twice = speeding();
+    if (!moveHead(input.nowMs) || (twice && !moveHead(input.nowMs)))
+        return result;
+
+    timers.advance(input.nowMs, [this, &input](int64_t, const GameTimer& timer) { expire(timer, input.nowMs); });
+    return result;
+}
+
+// One cell on in the current heading; false if that ended the game
+bool GameEngine::moveHead(int64_t nowMs) {
+    const Cell head = body.head();
+    const Cell next = wrapped({ head.x + directionX(heading), head.y + directionY(heading) }, cfg.halfCols, cfg.halfRows);
+
+    // The tail leaves its cell during this move unless the snake is growing,
+    // so running into the current tail is legal
+    const CellKind target = cellAt(next);
+    const bool growing = target == CellKind::Food;
+    const bool intoTail = !growing && next == body.tail();
+    if (isObstacle(target) && !intoTail) {
+        endGame(false, target);
+        return false;
+    }
+
+    if (!growing) {
+        const Cell tail = body.tail();
+        body.popTail();
+        set(tail, CellKind::Empty);
+        paint(tail, CellKind::Empty);
+    }
+
+    body.pushHead(next);
+    set(next, CellKind::Snake);
+    paint(next, CellKind::Snake);
+    result.moved = true;
+
+    if (target == CellKind::PowerUp)
+        takePowerUp(nowMs);
+
+    if (growing) {
+        points += 1;
+        result.ateFood = true;
+        timers.cancel(foodTimer);
+        if (!growFood(nowMs)) {
+            endGame(true);
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,205 @@
+#ifndef GAMEENGINE_H
+#define GAMEENGINE_H
+
+#include "freecells.h"
+#include "gametypes.h"
+#include "level.h"
+#include "rng.h"
+#include "snakebody.h"
+#include "timerwheel.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Timed extras on top of the classic game. The defaults are the classic
+// game: one bomb at a time, food that stays put, no power-ups.
+struct GameRules {
+    int maxBombs = 1;               // bombs on the board or cooling down at once
+    int foodLifetimeMs = 0;         // uneaten food moves elsewhere after this long, 0 never
+    double powerUpProbability = 0;  // chance per tick that a power-up appears while there is none
+    int powerUpLifetimeMs = 8000;   // an untaken power-up disappears
+    int speedMs = 5000;             // Speed moves the snake two cells a tick for this long
+    int shrinkCells = 3;            // Shrink drops this many tail cells, down to two
+};
+
+enum class PowerUp : uint8_t { None, Speed, Shrink };
+
+struct GameConfig {
+    int halfCols = 30;            // board spans x in [-halfCols, halfCols)
+    int halfRows = 25;            // board spans y in [-halfRows, halfRows)
+    std::shared_ptr<const Level> level; // wall layout centred on the board, none for open play
+    uint64_t seed = 0;
+    double bombProbability = 0.3; // chance per tick that a missing bomb gets planted
+    int bombFuseMs = 12000;       // a planted bomb is diffused after this long
+    int bombAlertMs = 15000;      // the "BOMB DIFFUSED." notice is cleared
+    int bombCooldownMs = 20000;   // a new bomb may be planted
+    GameRules rules;
+};
+
+struct StepInput {
+    Direction turn = Direction::None; // requested heading, None keeps the current one
+    int64_t nowMs = 0;                // game clock, supplied by the caller
+};
+
+struct CellChange {
+    Cell cell;
+    CellKind kind;
+};
+
+struct StepResult {
+    bool moved = false;
+    bool ateFood = false;
+    bool gameOver = false;
+    bool boardFull = false;          // no free cell left for food, the game ends
+    CellKind collision = CellKind::Empty; // what the head ran into, if that ended the game
+    bool bombPlanted = false;
+    bool bombDiffused = false;
+    bool bombAlertCleared = false;
+    PowerUp poweredUp = PowerUp::None; // the power-up the head took
+    std::vector<CellChange> changes; // cells repainted by this step, in order
+};
+
+// What a pending timer does when it comes due. since is when the thing it
+// belongs to appeared, which later timers in a chain are counted from.
+enum class TimedEvent : uint8_t { BombDiffuse, BombAlertClear, BombCooldownEnd, FoodExpire, PowerUpExpire, SpeedEnd };
+
+struct GameTimer {
+    TimedEvent event = TimedEvent::BombDiffuse;
+    Cell cell = { 0, 0 };
+    int64_t since = 0;
+};
+
+// The bomb and food rules, shared with ArenaEngine so the two games cannot
+// drift apart. The timers go on the engine's wheel; the engine owns the board.
+
+// Whether a bomb goes down this step: bombs out and cooling down stay under
+// maxBombs, and the chance comes up
+inline bool rollBomb(const GameConfig& config, size_t bombs, int cooling, Rng& rng) {
+    return static_cast<int>(bombs) + cooling < config.rules.maxBombs && rng.uniform() <= config.bombProbability;
+}
+
+// A bomb planted at cell is diffused on the first tick more than a fuse later
+inline void scheduleFuse(TimerWheel<GameTimer>& timers, const GameConfig& config, Cell cell, int64_t nowMs) {
+    timers.schedule(nowMs + config.bombFuseMs + 1, { TimedEvent::BombDiffuse, cell, nowMs });
+}
+
+// After the fuse, the notice and the cooldown, both counted from the planting
+inline void scheduleCooldown(TimerWheel<GameTimer>& timers, const GameConfig& config, const GameTimer& fuse) {
+    timers.schedule(fuse.since + config.bombAlertMs + 1, { TimedEvent::BombAlertClear, fuse.cell, fuse.since });
+    timers.schedule(fuse.since + config.bombCooldownMs + 1, { TimedEvent::BombCooldownEnd, fuse.cell, fuse.since });
+}
+
+// Food placed at cell moves elsewhere once its lifetime is up; no timer if it stays put
+inline TimerId scheduleFoodExpiry(TimerWheel<GameTimer>& timers, const GameConfig& config, Cell cell, int64_t nowMs) {
+    if (config.rules.foodLifetimeMs <= 0)
+        return TimerId();
+    return timers.schedule(nowMs + config.rules.foodLifetimeMs, { TimedEvent::FoodExpire, cell, nowMs });
+}
+
+// Everything that changes while a game runs. Together with the GameConfig it
+// was started from, this is enough to carry on exactly where it left off.
+struct EngineState {
+    Direction heading = Direction::None;
+    int points = 0;
+    bool over = false;
+    bool foodPlaced = false;
+    Cell food = { 0, 0 };
+    std::vector<Cell> bombs;          // in the order they were planted
+    bool powerUpPlaced = false;
+    Cell powerUp = { 0, 0 };
+    PowerUp powerUpKind = PowerUp::None;
+    int64_t clock = 0;                // the next time the timers look at
+    std::vector<std::pair<int64_t, GameTimer>> timers; // (due, timer) in firing order
+    uint64_t rng[4] = {};
+    std::vector<Cell> body;           // tail first
+    std::vector<int> freeOrder;       // free grid cells in the order food and bombs are drawn from
+};
+
+// All of the game rules, without any widget or timer. The caller owns the
+// clock and feeds it in through step(); randomness comes from the seeded Rng.
+class GameEngine
+{
+public:
+    explicit GameEngine(const GameConfig& config = GameConfig());
+
+    void reset(const GameConfig& config);
+    void start();                              // set off to the right, as Enter does
+    const StepResult& step(const StepInput& input);
+
+    EngineState state() const;
+    // Resets to config and lays the saved state on top; fails, leaving a
+    // fresh game, if the state does not fit that board. The free cells keep
+    // their saved order, so the game goes on exactly as it would have.
+    bool restore(const GameConfig& config, const EngineState& saved);
+
+    const GameConfig& config() const { return cfg; }
+    Direction direction() const { return heading; }
+    bool isRunning() const { return heading != Direction::None && !over; }
+    bool isOver() const { return over; }
+    int score() const { return points; }
+    bool hasFood() const { return foodPlaced; }
+    bool hasBomb() const { return !bombCells.empty(); }
+    Cell food() const { return foodCell; }
+    Cell bomb() const { return bombCells.front(); }     // the oldest one
+    const std::vector<Cell>& bombs() const { return bombCells; }
+    bool hasPowerUp() const { return powerUpPlaced; }
+    Cell powerUp() const { return powerUpCell; }
+    PowerUp powerUpKind() const { return powerKind; }
+    bool speeding() const { return timers.pending(speedTimer); }
+    const SnakeBody& snake() const { return body; }
+    CellKind cellAt(Cell c) const { return grid[index(c)]; }
+    int columns() const { return cols; }
+    int rows() const { return rowCount; }
+    const CellKind* cells() const { return grid.data(); } // row-major, bottom row first
+
+private:
+    int index(Cell c) const { return (c.y + cfg.halfRows) * cols + (c.x + cfg.halfCols); }
+    bool contains(Cell c) const {
+        return c.x >= -cfg.halfCols && c.x < cfg.halfCols && c.y >= -cfg.halfRows && c.y < cfg.halfRows;
+    }
+    Cell cellAtIndex(int i) const { return { i % cols - cfg.halfCols, i / cols - cfg.halfRows }; }
+    void set(Cell c, CellKind kind) {
+        const int i = index(c);
+        grid[i] = kind;
+        if (kind == CellKind::Empty)
+            freeCells.insert(i);
+        else
+            freeCells.erase(i);
+    }
+    bool randomFreeCell(Cell& out);
+    void wallSpan(int y, int x0, int x1);
+    void stampLevel(const Level& level);
+    bool growFood(int64_t nowMs);
+    void endGame(bool boardFull, CellKind hit = CellKind::Empty);
+    void plantBomb(int64_t nowMs);
+    void placePowerUp(int64_t nowMs);
+    void takePowerUp(int64_t nowMs);
+    bool moveHead(int64_t nowMs);
+    void expire(const GameTimer& timer, int64_t nowMs);
+    void paint(Cell c, CellKind kind) { result.changes.push_back({ c, kind }); }
+
+    GameConfig cfg;
+    Rng rng;
+    StepResult result;
+    int cols = 0;
+    int rowCount = 0;
+    std::vector<CellKind> grid;   // single source of truth for what occupies each cell
+    FreeCells freeCells;          // every Empty cell of grid, for O(1) spawning
+    SnakeBody body;
+    Direction heading = Direction::None;
+    Cell foodCell;
+    bool foodPlaced = false;
+    TimerId foodTimer;
+    std::vector<Cell> bombCells;
+    int cooling = 0;          // bombs diffused whose cooldown is still running
+    Cell powerUpCell;
+    bool powerUpPlaced = false;
+    PowerUp powerKind = PowerUp::None;
+    TimerId powerUpTimer;
+    TimerId speedTimer;
+    TimerWheel<GameTimer> timers; // every timed thing on the board, on the game clock
+    int points = 0;
+    bool over = false;
+};
+
+#endif // GAMEENGINE_H
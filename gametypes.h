@@ -0,0 +1,61 @@
+#ifndef GAMETYPES_H
+#define GAMETYPES_H
+
+#include <cstdint>
+
+// Board coordinates are relative to the centre of the play field, exactly as
+// the old colorPointRelative() used them: x grows to the right, y grows up.
+struct Cell {
+    int x = 0;
+    int y = 0;
+
+    bool operator==(const Cell& other) const { return x == other.x && y == other.y; }
+    bool operator!=(const Cell& other) const { return !(*this == other); }
+};
+
+enum class Direction : uint8_t { None, Right, Left, Up, Down };
+
+inline int directionX(Direction d) { return d == Direction::Right ? 1 : d == Direction::Left ? -1 : 0; }
+inline int directionY(Direction d) { return d == Direction::Up ? 1 : d == Direction::Down ? -1 : 0; }
+inline bool isReversal(Direction a, Direction b) {
+    return directionX(a) == -directionX(b) && directionY(a) == -directionY(b) && a != Direction::None;
+}
+
+// Direction of a one-cell step from a to its neighbour b, allowing for the
+// wrap at the board edges
+inline Direction stepDirection(Cell a, Cell b) {
+    const int dx = b.x - a.x;
+    const int dy = b.y - a.y;
+    if (dy == 0)
+        return (dx == 1 || dx < -1) ? Direction::Right : Direction::Left;
+    return (dy == 1 || dy < -1) ? Direction::Up : Direction::Down;
+}
+
+// One cell on from the edge of a board spanning [-halfCols, halfCols) x
+// [-halfRows, halfRows) comes back in on the far side
+inline Cell wrapped(Cell c, int halfCols, int halfRows) {
+    if (c.x < -halfCols)
+        c.x = halfCols - 1;
+    else if (c.x >= halfCols)
+        c.x = -halfCols;
+    if (c.y < -halfRows)
+        c.y = halfRows - 1;
+    else if (c.y >= halfRows)
+        c.y = -halfRows;
+    return c;
+}
+
+enum class CellKind : uint8_t { Empty, Snake, Food, Bomb, Wall, PowerUp };
+
+// What kills a head moving in; a snake cell is fine only when it is a tail
+// leaving on the same step
+inline bool isObstacle(CellKind kind) {
+    return kind == CellKind::Snake || kind == CellKind::Wall || kind == CellKind::Bomb;
+}
+
+// The most cells (cols * rows) any board or level may have. Replays, levels
+// and --board are held to it, so a typo or a crafted file cannot ask for
+// gigabytes of grid.
+const int MaxBoardCells = 1 << 22;
+
+#endif // GAMETYPES_H
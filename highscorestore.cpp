@@ -0,0 +1,172 @@
+#include "highscorestore.h"
+#include <QFile>
+#include <QHash>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+// Narrows [begin, end) to drop the blanks around a field
+void trim(const char*& begin, const char*& end) {
+    while (begin < end && (*begin == ' ' || *begin == '\t'))
+        ++begin;
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+        --end;
+}
+
+// Plain decimal digits; -1 if that is not what is there
+int parseNumber(const char* begin, const char* end) {
+    trim(begin, end);
+    if (begin == end || end - begin > 9)
+        return -1;
+    int value = 0;
+    for (; begin < end; ++begin) {
+        if (*begin < '0' || *begin > '9')
+            return -1;
+        value = value * 10 + (*begin - '0');
+    }
+    return value;
+}
+
+// "hh:mm:ss" in seconds, -1 if it is not one
+int parseClock(const char* begin, const char* end) {
+    trim(begin, end);
+    if (end - begin != 8 || begin[2] != ':' || begin[5] != ':')
+        return -1;
+    const int hours = parseNumber(begin, begin + 2);
+    const int minutes = parseNumber(begin + 3, begin + 5);
+    const int seconds = parseNumber(begin + 6, end);
+    return hours < 0 || minutes < 0 || seconds < 0 ? -1 : hours * 3600 + minutes * 60 + seconds;
+}
+
+const char* findLast(const char* begin, const char* end, char c) {
+    while (end > begin) {
+        if (*--end == c)
+            return end;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+HighScoreStore::HighScoreStore(const QString& path)
+    : path(path)
+{
+    writer = std::thread(&HighScoreStore::run, this);
+}
+
+HighScoreStore::~HighScoreStore()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+}
+
+QByteArray HighScoreStore::formatRecord(const Record& record) {
+    return record.mode.toUtf8() + '-' + record.difficulty.toUtf8() + ',' + record.entry.name.toUtf8() + ','
+        + QByteArray::number(record.entry.score) + ',' + record.entry.time.toLatin1() + '\n';
+}
+
+// "mode-difficulty,name,score,hh:mm:ss"; the name is whatever sits between
+// the first and the last two commas, so a comma in a name does not break the
+// line. Lines are scanned in place, and names and boards are looked up
+// without copying, so a long history loads at the speed of the disk.
+Leaderboard HighScoreStore::load() {
+    Leaderboard board;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return board;
+    const QByteArray data = file.readAll();
+
+    QHash<QByteArray, std::pair<QString, QString>> boards; // the key column, split into mode and difficulty
+    const char* line = data.constData();
+    const char* const end = line + data.size();
+    // Only newline-terminated lines count: a trailing fragment is a write
+    // that was cut short
+    for (const char* next; (next = static_cast<const char*>(std::memchr(line, '\n', static_cast<size_t>(end - line))));
+         line = next + 1) {
+        const char* first = static_cast<const char*>(std::memchr(line, ',', static_cast<size_t>(next - line)));
+        const char* last = findLast(line, next, ',');
+        const char* middle = last ? findLast(line, last, ',') : nullptr;
+        if (!first || first == line || !middle || middle <= first)
+            continue;
+
+        const int score = parseNumber(middle + 1, last);
+        const int seconds = parseClock(last + 1, next);
+        if (score < 0 || seconds < 0)
+            continue;
+
+        const QByteArray key = QByteArray::fromRawData(line, static_cast<int>(first - line));
+        auto it = boards.constFind(key);
+        if (it == boards.constEnd()) {
+            const int dash = key.lastIndexOf('-');
+            if (dash <= 0)
+                continue;
+            it = boards.insert(QByteArray(key.constData(), key.size()),
+                               { QString::fromUtf8(key.left(dash)), QString::fromUtf8(key.mid(dash + 1)) });
+        }
+        board.addLoaded(it->first, it->second, QByteArray::fromRawData(first + 1, static_cast<int>(middle - first - 1)),
+                        score, seconds);
+    }
+    board.finishLoading();
+    return board;
+}
+
+void HighScoreStore::append(const QString& mode, const QString& difficulty, const HighScoreEntry& entry) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back({ mode, difficulty, entry });
+    }
+    wake.notify_one();
+}
+
+void HighScoreStore::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return pending.empty() && !writing; });
+}
+
+void HighScoreStore::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty() && stopping)
+            break;
+
+        std::vector<Record> batch(pending.begin(), pending.end());
+        pending.clear();
+        writing = true;
+        lock.unlock();
+
+        writeRecords(batch);
+
+        lock.lock();
+        writing = false;
+        idle.notify_all();
+    }
+}
+
+void HighScoreStore::writeRecords(const std::vector<Record>& records) {
+    QByteArray chunk;
+    if (!checkedTail) {
+        // First write: terminate a torn last line so the new record does not
+        // get glued onto it
+        QFile existing(path);
+        char last = '\n';
+        if (existing.open(QIODevice::ReadOnly) && existing.size() > 0 && existing.seek(existing.size() - 1)
+            && existing.getChar(&last) && last != '\n')
+            chunk += '\n';
+        checkedTail = true;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+        return;
+
+    for (const Record& record : records)
+        chunk += formatRecord(record);
+    file.write(chunk);
+    file.flush();
+}
@@ -0,0 +1,50 @@
+#ifndef HIGHSCORESTORE_H
+#define HIGHSCORESTORE_H
+
+#include "leaderboard.h"
+#include <QByteArray>
+#include <QString>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// high_scores.txt as an append-only journal of "mode-difficulty,name,score,
+// time" lines, one per game ever recorded, oldest first. Appends are handed
+// to a background writer so game over never waits on the disk, and only the
+// journal's last byte is looked at before the first one, however long the
+// history. Loading skips lines that are malformed or cut short.
+class HighScoreStore
+{
+public:
+    explicit HighScoreStore(const QString& path = "high_scores.txt");
+    ~HighScoreStore(); // drains pending writes
+
+    Leaderboard load();
+    void append(const QString& mode, const QString& difficulty, const HighScoreEntry& entry);
+    void flush();      // blocks until every queued record is written
+
+private:
+    struct Record {
+        QString mode;
+        QString difficulty;
+        HighScoreEntry entry;
+    };
+
+    static QByteArray formatRecord(const Record& record);
+    void run();
+    void writeRecords(const std::vector<Record>& records);
+
+    QString path;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<Record> pending;
+    bool writing = false;
+    bool stopping = false;
+    bool checkedTail = false;  // a torn last line has been dealt with
+    std::thread writer;
+};
+
+#endif // HIGHSCORESTORE_H
@@ -0,0 +1,63 @@
+#ifndef INPUTQUEUE_H
+#define INPUTQUEUE_H
+
+#include "gametypes.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+struct InputCommand {
+    Direction direction = Direction::None;
+    int64_t timestampNs = 0; // when the key was pressed
+};
+
+// Single-producer, single-consumer ring of turn requests. Key presses are
+// pushed as they arrive and the tick pops them, so quick sequences such as
+// Up then Left inside one tick are kept in order instead of overwritten.
+class InputQueue
+{
+public:
+    static constexpr uint32_t Capacity = 16; // power of two
+
+    bool push(const InputCommand& command) {
+        const uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity)
+            return false; // full, drop the newest press
+        slots[t & (Capacity - 1)] = command;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(InputCommand& command) {
+        const uint32_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        command = slots[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side only
+    void clear() { head.store(tail.load(std::memory_order_acquire), std::memory_order_release); }
+
+private:
+    InputCommand slots[Capacity];
+    std::atomic<uint32_t> head{ 0 };
+    std::atomic<uint32_t> tail{ 0 };
+};
+
+struct LatencyStats {
+    int64_t count = 0;
+    int64_t totalNs = 0;
+    int64_t maxNs = 0;
+
+    void record(int64_t ns) {
+        ++count;
+        totalNs += ns;
+        maxNs = std::max(maxNs, ns);
+    }
+    double meanMs() const { return count ? totalNs / 1e6 / count : 0.0; }
+    double maxMs() const { return maxNs / 1e6; }
+};
+
+#endif // INPUTQUEUE_H
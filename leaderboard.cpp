@@ -0,0 +1,138 @@
+#include "leaderboard.h"
+#include <algorithm>
+
+ScoreResult ScoreBoard::record(uint32_t player, int score, int seconds) {
+    ScoreResult result;
+    result.score = score;
+    result.seconds = seconds;
+    result.player = player;
+    result.order = static_cast<uint32_t>(results.size());
+    results.push_back(result);
+
+    PlayerResults& mine = players[player];
+    if (mine.orders.empty() || Better()(result, results[mine.best]))
+        mine.best = result.order;
+    mine.orders.push_back(result.order);
+    return result;
+}
+
+int ScoreBoard::add(uint32_t player, int score, int seconds) {
+    return static_cast<int>(ranking.insert(record(player, score, seconds))) + 1;
+}
+
+std::vector<ScoreResult> ScoreBoard::top(size_t count) const {
+    std::vector<ScoreResult> out;
+    out.reserve(std::min(count, ranking.size()));
+    ranking.visit(0, count, [&out](const ScoreResult& result) { out.push_back(result); });
+    return out;
+}
+
+// Behind every result that scored more, or the same in no more time
+int ScoreBoard::rankOf(int score, int seconds) const {
+    return static_cast<int>(ranking.countBefore([score, seconds](const ScoreResult& result) {
+        return result.score > score || (result.score == score && result.seconds <= seconds);
+    })) + 1;
+}
+
+double ScoreBoard::percentileOf(int score) const {
+    if (ranking.empty())
+        return 0.0;
+    const size_t atLeast = ranking.countBefore([score](const ScoreResult& result) { return result.score >= score; });
+    return 100.0 * static_cast<double>(ranking.size() - atLeast) / static_cast<double>(ranking.size());
+}
+
+const ScoreResult* ScoreBoard::best(uint32_t player) const {
+    const auto it = players.find(player);
+    return it == players.end() ? nullptr : &results[it->second.best];
+}
+
+std::vector<ScoreResult> ScoreBoard::history(uint32_t player) const {
+    std::vector<ScoreResult> out;
+    const auto it = players.find(player);
+    if (it == players.end())
+        return out;
+    out.reserve(it->second.orders.size());
+    for (uint32_t order : it->second.orders)
+        out.push_back(results[order]);
+    return out;
+}
+
+ScoreBoard& Leaderboard::boardFor(const QString& mode, const QString& difficulty) {
+    return boards[{ mode, difficulty }];
+}
+
+uint32_t Leaderboard::internName(const QByteArray& utf8Name) {
+    const auto it = ids.constFind(utf8Name);
+    if (it != ids.constEnd())
+        return it.value();
+    const uint32_t id = static_cast<uint32_t>(names.size());
+    // A deep copy: the caller's bytes may be borrowed (QByteArray::fromRawData)
+    ids.insert(QByteArray(utf8Name.constData(), utf8Name.size()), id);
+    names.push_back(QString::fromUtf8(utf8Name));
+    return id;
+}
+
+uint32_t Leaderboard::playerId(const QString& name) {
+    return internName(name.toUtf8());
+}
+
+bool Leaderboard::findPlayer(const QString& name, uint32_t& id) const {
+    const auto it = ids.constFind(name.toUtf8());
+    if (it == ids.constEnd())
+        return false;
+    id = it.value();
+    return true;
+}
+
+int Leaderboard::add(const QString& mode, const QString& difficulty, const HighScoreEntry& entry) {
+    const int seconds = clockSeconds(entry.time);
+    return boardFor(mode, difficulty).add(playerId(entry.name), entry.score, seconds < 0 ? 0 : seconds);
+}
+
+const ScoreBoard* Leaderboard::board(const QString& mode, const QString& difficulty) const {
+    const auto it = boards.find({ mode, difficulty });
+    return it == boards.end() ? nullptr : &it->second;
+}
+
+size_t Leaderboard::size() const {
+    size_t total = 0;
+    for (const auto& pair : boards)
+        total += pair.second.size();
+    return total;
+}
+
+void Leaderboard::addLoaded(const QString& mode, const QString& difficulty, const QByteArray& utf8Name, int score,
+                            int seconds) {
+    ScoreBoard& board = boardFor(mode, difficulty);
+    board.loading = true;
+    board.record(internName(utf8Name), score, seconds);
+}
+
+void Leaderboard::finishLoading() {
+    for (auto& pair : boards) {
+        ScoreBoard& board = pair.second;
+        if (!board.loading)
+            continue;
+        board.ranking.assign(board.results);
+        board.loading = false;
+    }
+}
+
+int Leaderboard::clockSeconds(const QString& time) {
+    if (time.size() != 8 || time[2] != ':' || time[5] != ':')
+        return -1;
+    bool ok[3];
+    const int hours = time.left(2).toInt(&ok[0]);
+    const int minutes = time.mid(3, 2).toInt(&ok[1]);
+    const int seconds = time.mid(6, 2).toInt(&ok[2]);
+    if (!ok[0] || !ok[1] || !ok[2] || hours < 0 || minutes < 0 || seconds < 0)
+        return -1;
+    return hours * 3600 + minutes * 60 + seconds;
+}
+
+QString Leaderboard::clockText(int seconds) {
+    return QString("%1:%2:%3")
+        .arg(seconds / 3600, 2, 10, QChar('0'))
+        .arg(seconds / 60 % 60, 2, 10, QChar('0'))
+        .arg(seconds % 60, 2, 10, QChar('0'));
+}
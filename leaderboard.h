@@ -0,0 +1,104 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include "ranktree.h"
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A result as the journal and the window have it
+struct HighScoreEntry {
+    QString name;
+    int score;
+    QString time; // Format: "hh:mm:ss"
+};
+
+// A result as the leaderboard keeps it. Higher scores rank first, then
+// shorter games, then whichever was recorded first, so no two results tie.
+struct ScoreResult {
+    int score = 0;
+    int seconds = 0;
+    uint32_t player = 0;  // Leaderboard::playerName() has the name
+    uint32_t order = 0;   // position among the board's results, oldest first
+};
+
+// Every result ever recorded on one mode and difficulty, ranked
+class ScoreBoard
+{
+public:
+    size_t size() const { return ranking.size(); }
+    int add(uint32_t player, int score, int seconds); // the 1-based rank it took
+
+    std::vector<ScoreResult> top(size_t count) const;
+    const ScoreResult& atRank(int rank) const { return ranking.at(static_cast<size_t>(rank) - 1); }
+    int rankOf(int score, int seconds) const;   // where a new result like that would place
+    double percentileOf(int score) const;       // share of results scoring lower, 0-100
+    const ScoreResult* best(uint32_t player) const; // nullptr if they never played here
+    std::vector<ScoreResult> history(uint32_t player) const; // oldest first
+
+private:
+    friend class Leaderboard;
+
+    struct Better {
+        bool operator()(const ScoreResult& a, const ScoreResult& b) const {
+            if (a.score != b.score)
+                return a.score > b.score;
+            if (a.seconds != b.seconds)
+                return a.seconds < b.seconds;
+            return a.order < b.order;
+        }
+    };
+
+    struct PlayerResults {
+        std::vector<uint32_t> orders; // their results, by order
+        uint32_t best = 0;
+    };
+
+    ScoreResult record(uint32_t player, int score, int seconds);
+
+    RankTree<ScoreResult, Better> ranking;
+    std::vector<ScoreResult> results;  // by order
+    std::unordered_map<uint32_t, PlayerResults> players;
+    bool loading = false;              // results are in, the ranking is built at the end
+};
+
+// The leaderboards of every mode and difficulty, with the player names
+// shared between them. A history of millions of results loads in a sort and
+// a linear build; after that each result goes in, and each rank, percentile
+// or top-k query comes out, in O(log n).
+class Leaderboard
+{
+public:
+    int add(const QString& mode, const QString& difficulty, const HighScoreEntry& entry); // 1-based rank
+    const ScoreBoard* board(const QString& mode, const QString& difficulty) const;
+    int boardCount() const { return static_cast<int>(boards.size()); }
+    size_t size() const;
+
+    uint32_t playerId(const QString& name);
+    bool findPlayer(const QString& name, uint32_t& id) const;
+    const QString& playerName(uint32_t id) const { return names[static_cast<int>(id)]; }
+
+    // Bulk loading: every stored result in the order it was recorded, then
+    // finishLoading() once to rank them. utf8Name need not outlive the call.
+    void addLoaded(const QString& mode, const QString& difficulty, const QByteArray& utf8Name, int score, int seconds);
+    void finishLoading();
+
+    static int clockSeconds(const QString& time); // "hh:mm:ss", -1 if it is not one
+    static QString clockText(int seconds);
+
+private:
+    ScoreBoard& boardFor(const QString& mode, const QString& difficulty);
+    uint32_t internName(const QByteArray& utf8Name);
+
+    std::map<std::pair<QString, QString>, ScoreBoard> boards;
+    QHash<QByteArray, uint32_t> ids;   // by UTF-8 name
+    QVector<QString> names;            // by id
+};
+
+#endif // LEADERBOARD_H
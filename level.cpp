@@ -0,0 +1,177 @@
+#include "level.h"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstring>
+
+namespace {
+
+struct Cursor {
+    const char* p;
+    const char* end;
+
+    void skipSpaces() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            ++p;
+    }
+    bool atLineEnd() const { return p >= end || *p == '\n' || *p == ';'; }
+    void nextLine() {
+        while (p < end && *p != '\n')
+            ++p;
+        if (p < end)
+            ++p;
+    }
+    bool readInt(int& value) {
+        skipSpaces();
+        if (p >= end || !std::isdigit(static_cast<unsigned char>(*p)))
+            return false;
+        long long v = 0;
+        while (p < end && std::isdigit(static_cast<unsigned char>(*p))) {
+            v = v * 10 + (*p++ - '0');
+            if (v > INT_MAX)
+                return false;
+        }
+        value = static_cast<int>(v);
+        return true;
+    }
+    bool readKeyword(const char* word) {
+        skipSpaces();
+        const size_t n = std::strlen(word);
+        if (static_cast<size_t>(end - p) < n || std::strncmp(p, word, n) != 0)
+            return false;
+        if (p + n < end && !std::isspace(static_cast<unsigned char>(p[n])))
+            return false;
+        p += n;
+        return true;
+    }
+};
+
+bool fail(std::string* error, int line, const char* message) {
+    if (error)
+        *error = "line " + std::to_string(line) + ": " + message;
+    return false;
+}
+
+} // namespace
+
+bool parseLevel(const char* data, size_t size, Level& level, std::string* error) {
+    level = Level();
+    Cursor in = { data, data + size };
+    int line = 0;
+    int row = 0;
+    std::vector<uint8_t> rowCells;
+
+    while (in.p < in.end) {
+        ++line;
+        in.skipSpaces();
+        if (in.atLineEnd()) {
+            in.nextLine();
+            continue;
+        }
+
+        if (in.readKeyword("name")) {
+            in.skipSpaces();
+            const char* start = in.p;
+            while (in.p < in.end && *in.p != '\n' && *in.p != '\r')
+                ++in.p;
+            level.name.assign(start, in.p);
+            in.nextLine();
+            continue;
+        }
+        if (in.readKeyword("size")) {
+            if (!in.readInt(level.cols) || !in.readInt(level.rows) || level.cols <= 0 || level.rows <= 0)
+                return fail(error, line, "expected 'size <cols> <rows>'");
+            if (static_cast<long long>(level.cols) * level.rows > MaxBoardCells)
+                return fail(error, line, "level is larger than any board");
+            level.walls.assign(static_cast<size_t>(level.cols) * level.rows, 0);
+            rowCells.reserve(level.cols);
+            in.nextLine();
+            continue;
+        }
+        if (level.cols == 0)
+            return fail(error, line, "rows before 'size'");
+
+        // A row: runs of <count><#|.>, optionally followed by x<repeat>
+        rowCells.clear();
+        int repeat = 1;
+        while (true) {
+            in.skipSpaces();
+            if (in.atLineEnd())
+                break;
+            if (*in.p == 'x') {
+                ++in.p;
+                if (!in.readInt(repeat) || repeat <= 0)
+                    return fail(error, line, "bad repeat count");
+                continue;
+            }
+            int count = 1;
+            if (std::isdigit(static_cast<unsigned char>(*in.p)) && !in.readInt(count))
+                return fail(error, line, "bad run length");
+            if (in.p >= in.end || (*in.p != '#' && *in.p != '.'))
+                return fail(error, line, "expected '#' or '.'");
+            const uint8_t cell = *in.p++ == '#' ? 1 : 0;
+            if (count > level.cols - static_cast<int>(rowCells.size()))
+                return fail(error, line, "row is wider than the level");
+            rowCells.insert(rowCells.end(), count, cell);
+        }
+        if (static_cast<int>(rowCells.size()) != level.cols)
+            return fail(error, line, "row is narrower than the level");
+        if (repeat > level.rows - row)
+            return fail(error, line, "more rows than the level height");
+
+        for (int i = 0; i < repeat; ++i, ++row)
+            std::memcpy(level.walls.data() + static_cast<size_t>(row) * level.cols, rowCells.data(), level.cols);
+        in.nextLine();
+    }
+
+    if (level.cols == 0)
+        return fail(error, line, "missing 'size'");
+    if (row != level.rows)
+        return fail(error, line, "fewer rows than the level height");
+    return true;
+}
+
+std::string encodeLevel(const Level& level) {
+    std::string out;
+    if (!level.name.empty())
+        out += "name " + level.name + "\n";
+    out += "size " + std::to_string(level.cols) + " " + std::to_string(level.rows) + "\n";
+
+    auto rowAt = [&](int r) { return level.walls.data() + static_cast<size_t>(r) * level.cols; };
+    for (int r = 0; r < level.rows;) {
+        int repeat = 1;
+        while (r + repeat < level.rows && std::memcmp(rowAt(r), rowAt(r + repeat), level.cols) == 0)
+            ++repeat;
+
+        const uint8_t* cells = rowAt(r);
+        for (int c = 0; c < level.cols;) {
+            int run = 1;
+            while (c + run < level.cols && cells[c + run] == cells[c])
+                ++run;
+            if (c > 0)
+                out += ' ';
+            out += std::to_string(run);
+            out += cells[c] ? '#' : '.';
+            c += run;
+        }
+        if (repeat > 1)
+            out += " x" + std::to_string(repeat);
+        out += '\n';
+        r += repeat;
+    }
+    return out;
+}
+
+Level cropLevel(const Level& level, int cols, int rows) {
+    Level cropped;
+    cropped.name = level.name;
+    cropped.cols = std::min(level.cols, cols);
+    cropped.rows = std::min(level.rows, rows);
+    const int left = level.cols / 2 - cropped.cols / 2;
+    const int top = level.rows / 2 - cropped.rows / 2;
+    cropped.walls.resize(static_cast<size_t>(cropped.cols) * cropped.rows);
+    for (int r = 0; r < cropped.rows; ++r)
+        std::memcpy(cropped.walls.data() + static_cast<size_t>(r) * cropped.cols,
+                    level.walls.data() + static_cast<size_t>(top + r) * level.cols + left, cropped.cols);
+    return cropped;
+}
@@ -0,0 +1,36 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include "gametypes.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A wall layout, loaded from a .lvl file. The format is plain text:
+//
+//   ; comment
+//   name Jailed
+//   size 60 50
+//   60# x2          <- a row of 60 wall cells, repeated twice
+//   2# 56. 2# x46   <- runs of wall (#) and free (.) cells
+//   60# x2
+//
+// Rows are listed top to bottom and every row must add up to the width. A
+// level has at most MaxBoardCells cells.
+struct Level {
+    std::string name;
+    int cols = 0;
+    int rows = 0;
+    std::vector<uint8_t> walls; // cols * rows, row-major, top row first; 1 = wall
+
+    bool wallAt(int col, int row) const { return walls[static_cast<size_t>(row) * cols + col] != 0; }
+};
+
+bool parseLevel(const char* data, size_t size, Level& level, std::string* error = nullptr);
+std::string encodeLevel(const Level& level);
+
+// The part of a level that lands on a cols x rows board (both even), still
+// centred, so it lays out the same walls there as the whole level does
+Level cropLevel(const Level& level, int cols, int rows);
+
+#endif // LEVEL_H
@@ -0,0 +1,51 @@
+#include "levelfiles.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+std::shared_ptr<const Level> loadLevelFile(const QString& mode) {
+    const QString fileName = "levels/" + mode + ".lvl";
+    const QStringList candidates = { QDir::current().filePath(fileName),
+                                     QDir(QCoreApplication::applicationDirPath()).filePath(fileName),
+                                     ":/" + fileName };
+    for (const QString& path : candidates) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+            continue;
+
+        const QByteArray data = file.readAll();
+        auto level = std::make_shared<Level>();
+        std::string error;
+        if (parseLevel(data.constData(), static_cast<size_t>(data.size()), *level, &error))
+            return level;
+        qDebug() << "Ignoring level" << path << ":" << QString::fromStdString(error);
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const Level> loadGeneratedLevel(const LevelSpec& spec) {
+    const QString dir = "levels/generated";
+    const QString path = dir + "/" + QString::fromStdString(levelCacheName(spec));
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        const QByteArray data = file.readAll();
+        auto level = std::make_shared<Level>();
+        if (parseLevel(data.constData(), static_cast<size_t>(data.size()), *level) && level->cols == spec.cols
+            && level->rows == spec.rows && levelConnected(*level))
+            return level;
+        qDebug() << "Regenerating level" << path;
+    }
+
+    auto level = std::make_shared<Level>();
+    if (!generateLevel(spec, *level))
+        return nullptr;
+    QDir().mkpath(dir);
+    QSaveFile out(path);
+    if (out.open(QIODevice::WriteOnly)) {
+        out.write(QByteArray::fromStdString(encodeLevel(*level)));
+        out.commit();
+    }
+    return level;
+}
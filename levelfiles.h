@@ -0,0 +1,20 @@
+#ifndef LEVELFILES_H
+#define LEVELFILES_H
+
+#include "level.h"
+#include "levelgen.h"
+#include <QString>
+#include <memory>
+
+// Levels are looked up as <mode>.lvl in ./levels, then next to the executable,
+// then among the built-in ones, so a layout can be replaced without a rebuild.
+// No file at all means an open board, and nullptr is returned.
+std::shared_ptr<const Level> loadLevelFile(const QString& mode);
+
+// Generated levels are cached in ./levels/generated, a file per spec and
+// seed, so each layout is generated once and read back after that. A cached
+// file that no longer parses or passes the connectivity check is replaced.
+// Safe to call from any thread; nullptr if the spec cannot make a level.
+std::shared_ptr<const Level> loadGeneratedLevel(const LevelSpec& spec);
+
+#endif // LEVELFILES_H
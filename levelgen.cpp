@@ -0,0 +1,289 @@
+#include "levelgen.h"
+#include "rng.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+// The snake starts on (-2..2, 0) heading right. Its row and the ones either
+// side stay free from a little behind the tail to well ahead of the head.
+const int ClearBehind = 4;
+const int ClearAhead = 10;
+
+bool inClearing(const Level& level, int col, int row) {
+    const int x = col - level.cols / 2;
+    const int y = level.rows / 2 - 1 - row;
+    return y >= -1 && y <= 1 && x >= -ClearBehind && x <= ClearAhead;
+}
+
+void clearStart(Level& level) {
+    for (int row = 0; row < level.rows; ++row)
+        for (int col = 0; col < level.cols; ++col)
+            if (inClearing(level, col, row))
+                level.walls[static_cast<size_t>(row) * level.cols + col] = 0;
+}
+
+void shuffle(std::vector<int>& cells, Rng& rng) {
+    for (size_t i = cells.size(); i > 1; --i)
+        std::swap(cells[i - 1], cells[rng.bounded(static_cast<uint32_t>(i))]);
+}
+
+// Marks every free cell reachable from the starting row, wrapping at the
+// edges; returns how many that is, or -1 if the starting row is walled or
+// off the level
+int floodFromStart(const Level& level, std::vector<uint8_t>& reached) {
+    const int cols = level.cols;
+    const int rows = level.rows;
+    reached.assign(level.walls.size(), 0);
+    std::vector<int> stack;
+    int count = 0;
+
+    const int row = rows / 2 - 1;
+    for (int x = -2; x <= 2; ++x) {
+        const int col = x + cols / 2;
+        if (row < 0 || col < 0 || col >= cols)
+            return -1;
+        const int i = row * cols + col;
+        if (level.walls[i])
+            return -1;
+        if (!reached[i]) {
+            reached[i] = 1;
+            stack.push_back(i);
+            ++count;
+        }
+    }
+
+    while (!stack.empty()) {
+        const int i = stack.back();
+        stack.pop_back();
+        const int col = i % cols;
+        const int r = i / cols;
+        const int neighbours[4] = { r * cols + (col == 0 ? cols - 1 : col - 1),
+                                    r * cols + (col == cols - 1 ? 0 : col + 1),
+                                    (r == 0 ? rows - 1 : r - 1) * cols + col,
+                                    (r == rows - 1 ? 0 : r + 1) * cols + col };
+        for (int n : neighbours) {
+            if (level.walls[n] || reached[n])
+                continue;
+            reached[n] = 1;
+            stack.push_back(n);
+            ++count;
+        }
+    }
+    return count;
+}
+
+// A perfect maze: rooms on the odd columns and rows, joined by opening the
+// wall cell between two of them, depth first from a random room. An even
+// side wraps, so the maze runs on round the board edges.
+void carveMaze(Level& level, Rng& rng) {
+    const int cols = level.cols;
+    const int rows = level.rows;
+    const int roomCols = cols / 2;
+    const int roomRows = rows / 2;
+    std::fill(level.walls.begin(), level.walls.end(), 1);
+    if (roomCols == 0 || roomRows == 0) {
+        std::fill(level.walls.begin(), level.walls.end(), 0);
+        return;
+    }
+    const bool wrapX = cols % 2 == 0;
+    const bool wrapY = rows % 2 == 0;
+    auto open = [&level, cols](int col, int row) { level.walls[static_cast<size_t>(row) * cols + col] = 0; };
+
+    std::vector<uint8_t> visited(static_cast<size_t>(roomCols) * roomRows, 0);
+    std::vector<int> stack;
+    const int first = static_cast<int>(rng.bounded(static_cast<uint32_t>(visited.size())));
+    visited[first] = 1;
+    open(first % roomCols * 2 + 1, first / roomCols * 2 + 1);
+    stack.push_back(first);
+
+    const int dx[4] = { 1, -1, 0, 0 };
+    const int dy[4] = { 0, 0, 1, -1 };
+    while (!stack.empty()) {
+        const int room = stack.back();
+        const int rx = room % roomCols;
+        const int ry = room / roomCols;
+        int next[4];
+        int ways[4];
+        int count = 0;
+        for (int d = 0; d < 4; ++d) {
+            int nx = rx + dx[d];
+            int ny = ry + dy[d];
+            if (nx < 0 || nx >= roomCols) {
+                if (!wrapX || roomCols < 3)
+                    continue;
+                nx = (nx + roomCols) % roomCols;
+            }
+            if (ny < 0 || ny >= roomRows) {
+                if (!wrapY || roomRows < 3)
+                    continue;
+                ny = (ny + roomRows) % roomRows;
+            }
+            const int n = ny * roomCols + nx;
+            if (!visited[n]) {
+                next[count] = n;
+                ways[count++] = d;
+            }
+        }
+        if (count == 0) {
+            stack.pop_back();
+            continue;
+        }
+        const int pick = static_cast<int>(rng.bounded(static_cast<uint32_t>(count)));
+        const int n = next[pick];
+        const int d = ways[pick];
+        open((rx * 2 + 1 + dx[d] + cols) % cols, (ry * 2 + 1 + dy[d] + rows) % rows);
+        open(n % roomCols * 2 + 1, n / roomCols * 2 + 1);
+        visited[n] = 1;
+        stack.push_back(n);
+    }
+}
+
+// Knocks out walls until at most target are left: those between rooms
+// first, which adds loops, then the pillars at the corners. Every removal
+// only joins free cells, so the maze stays connected.
+void openMaze(Level& level, Rng& rng, int target) {
+    std::vector<int> between;
+    std::vector<int> pillars;
+    for (int i = 0; i < static_cast<int>(level.walls.size()); ++i) {
+        if (!level.walls[i])
+            continue;
+        const bool oddCol = i % level.cols % 2 == 1;
+        const bool oddRow = i / level.cols % 2 == 1;
+        (oddCol || oddRow ? between : pillars).push_back(i);
+    }
+    shuffle(between, rng);
+    shuffle(pillars, rng);
+    int walls = static_cast<int>(between.size() + pillars.size());
+    for (const std::vector<int>* cells : { &between, &pillars }) {
+        for (int i : *cells) {
+            if (walls <= target)
+                return;
+            level.walls[i] = 0;
+            --walls;
+        }
+    }
+}
+
+// Bars three to ten cells long and small square blocks, dropped anywhere but
+// the start, wrapping at the edges, until target cells are wall. They go in
+// batches, each followed by a flood fill from the start. A batch that cuts
+// off a few cells keeps them as wall; one that cuts off more is taken out
+// again and retried at half the size, down to single shapes, which are then
+// just skipped.
+void scatterObstacles(Level& level, Rng& rng, int target) {
+    const int cols = level.cols;
+    const int rows = level.rows;
+    const int cells = cols * rows;
+    std::fill(level.walls.begin(), level.walls.end(), 0);
+    std::vector<int> placed; // cells walled by the batch on trial
+    std::vector<uint8_t> reached;
+    int walls = 0;
+    int batch = 1;
+    int floods = std::max(256, 50000000 / cells); // a bound on the checking for near-impossible targets
+    for (int tries = 0; walls < target && tries < cells * 4 && floods > 0; --floods) {
+        placed.clear();
+        for (int k = 0; k < batch && walls < target; ++k, ++tries) {
+            int width = 1;
+            int height = 1;
+            switch (rng.bounded(3)) {
+            case 0:
+                width = 3 + static_cast<int>(rng.bounded(8));
+                break;
+            case 1:
+                height = 3 + static_cast<int>(rng.bounded(8));
+                break;
+            default:
+                width = height = 2 + static_cast<int>(rng.bounded(2));
+                break;
+            }
+            const int left = static_cast<int>(rng.bounded(static_cast<uint32_t>(cols)));
+            const int top = static_cast<int>(rng.bounded(static_cast<uint32_t>(rows)));
+            for (int r = 0; r < height; ++r) {
+                for (int c = 0; c < width; ++c) {
+                    const int col = (left + c) % cols;
+                    const int row = (top + r) % rows;
+                    const int i = row * cols + col;
+                    if (!level.walls[i] && !inClearing(level, col, row)) {
+                        level.walls[i] = 1;
+                        placed.push_back(i);
+                        ++walls;
+                    }
+                }
+            }
+        }
+
+        // Small pockets are walled in and count towards the target; cutting
+        // off more than that undoes the batch
+        const int lost = cells - walls - floodFromStart(level, reached);
+        if (lost <= static_cast<int>(placed.size()) / 4) {
+            for (int i = 0; lost > 0 && i < cells; ++i) {
+                if (!level.walls[i] && !reached[i]) {
+                    level.walls[i] = 1;
+                    ++walls;
+                }
+            }
+            batch = std::min(batch * 2, 1 + std::max(0, target - walls) / 8);
+            continue;
+        }
+        for (int i : placed)
+            level.walls[i] = 0;
+        walls -= static_cast<int>(placed.size());
+        batch = std::max(1, batch / 2);
+    }
+}
+
+} // namespace
+
+bool generateLevel(const LevelSpec& spec, Level& level) {
+    level = Level();
+    if (spec.cols <= 0 || spec.rows <= 0)
+        return false;
+    level.name = std::string(levelStyleName(spec.style)) + " " + std::to_string(spec.seed);
+    level.cols = spec.cols;
+    level.rows = spec.rows;
+    level.walls.assign(static_cast<size_t>(spec.cols) * spec.rows, 0);
+
+    const int target = static_cast<int>(level.walls.size() * std::clamp(spec.density, 0, 100) / 100);
+    Rng rng(spec.seed);
+    if (spec.style == LevelStyle::Maze) {
+        carveMaze(level, rng);
+        openMaze(level, rng, target);
+    }
+    else {
+        scatterObstacles(level, rng, target);
+    }
+    clearStart(level);
+    return levelConnected(level);
+}
+
+bool levelConnected(const Level& level) {
+    if (level.cols <= 0 || level.rows <= 0)
+        return false;
+    std::vector<uint8_t> reached;
+    const int count = floodFromStart(level, reached);
+    return count >= 0 && count == static_cast<int>(std::count(level.walls.begin(), level.walls.end(), 0));
+}
+
+const char* levelStyleName(LevelStyle style) {
+    return style == LevelStyle::Maze ? "Maze" : "Obstacles";
+}
+
+bool parseLevelStyle(const std::string& name, LevelStyle& style) {
+    std::string lower(name);
+    for (char& c : lower)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    if (lower == "maze")
+        style = LevelStyle::Maze;
+    else if (lower == "obstacles")
+        style = LevelStyle::Obstacles;
+    else
+        return false;
+    return true;
+}
+
+std::string levelCacheName(const LevelSpec& spec) {
+    const std::string style = spec.style == LevelStyle::Maze ? "maze" : "obstacles";
+    return style + "-" + std::to_string(spec.cols) + "x" + std::to_string(spec.rows) + "-"
+           + std::to_string(std::clamp(spec.density, 0, 100)) + "-" + std::to_string(spec.seed) + ".lvl";
+}
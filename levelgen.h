@@ -0,0 +1,38 @@
+#ifndef LEVELGEN_H
+#define LEVELGEN_H
+
+#include "level.h"
+#include <cstdint>
+#include <string>
+
+enum class LevelStyle : uint8_t { Maze, Obstacles };
+
+// A generated layout is fully determined by its spec, so the seed names it:
+// the same spec always gives the same level.
+struct LevelSpec {
+    LevelStyle style = LevelStyle::Maze;
+    int cols = 60;
+    int rows = 50;
+    int density = 20;     // percentage of the board that is wall; a maze tops out at about half
+    uint64_t seed = 1;
+};
+
+// Maze: corridors a cell wide, carved as a perfect maze on a lattice that
+// wraps round the board edges as the snake does, then opened up by knocking
+// out walls until the density is down to the target. Obstacles: straight
+// bars and blocks scattered until the density is reached, checked as they
+// go so none walls off more than a small pocket, which is filled in. Either
+// way the start of the game is kept clear and the result passes
+// levelConnected().
+bool generateLevel(const LevelSpec& spec, Level& level);
+
+// Whether every free cell can be reached from the snake's starting row,
+// cells (-2..2, 0) of a board the level is centred on, moving through
+// free cells and wrapping at the edges
+bool levelConnected(const Level& level);
+
+const char* levelStyleName(LevelStyle style);
+bool parseLevelStyle(const std::string& name, LevelStyle& style); // case-insensitive
+std::string levelCacheName(const LevelSpec& spec); // e.g. "maze-60x50-20-1234.lvl"
+
+#endif // LEVELGEN_H
@@ -0,0 +1,73 @@
+#include "levelsupply.h"
+#include "levelfiles.h"
+#include <QRandomGenerator>
+#include <QtConcurrent>
+#include <algorithm>
+#include <vector>
+
+LevelSupply::LevelSupply() {
+    // Results come back on the GUI thread; any made for an older spec are dropped
+    QObject::connect(&watcher, &QFutureWatcherBase::resultReadyAt, &watcher, [this](int index) {
+        const Made made = watcher.resultAt(index);
+        if (!made.level || !sameLayouts(made.spec, spec))
+            return;
+        ready.push_back(made.level);
+        if (ready.size() == 1 && onReady)
+            onReady();
+    });
+    // A batch cancelled by configure() makes way for one of the new spec
+    QObject::connect(&watcher, &QFutureWatcherBase::finished, &watcher, [this] { refill(); });
+}
+
+LevelSupply::~LevelSupply() {
+    watcher.cancel();
+    watcher.waitForFinished();
+}
+
+void LevelSupply::configure(LevelStyle style, int density, int cols, int rows) {
+    LevelSpec next;
+    next.style = style;
+    next.density = std::clamp(density, 0, 100);
+    next.cols = cols;
+    next.rows = rows;
+    if (configured && sameLayouts(next, spec))
+        return;
+
+    watcher.cancel();
+    ready.clear();
+    spec = next;
+    configured = true;
+    refill();
+}
+
+std::shared_ptr<const Level> LevelSupply::take() {
+    std::shared_ptr<const Level> level;
+    if (!ready.empty()) {
+        level = ready.front();
+        ready.pop_front();
+    }
+    refill();
+    return level;
+}
+
+LevelSupply::Made LevelSupply::make(const LevelSpec& spec) {
+    return { spec, loadGeneratedLevel(spec) };
+}
+
+bool LevelSupply::sameLayouts(const LevelSpec& a, const LevelSpec& b) {
+    return a.style == b.style && a.density == b.density && a.cols == b.cols && a.rows == b.rows;
+}
+
+// Tops the ready levels up, all the missing ones at once across the pool.
+// Levels taken while a batch is being made are made up for when it finishes.
+void LevelSupply::refill() {
+    if (!configured || watcher.isRunning())
+        return;
+    const int missing = Ahead - static_cast<int>(ready.size());
+    if (missing <= 0)
+        return;
+    std::vector<LevelSpec> specs(missing, spec);
+    for (LevelSpec& s : specs)
+        s.seed = 1 + QRandomGenerator::global()->bounded(Seeds);
+    watcher.setFuture(QtConcurrent::mapped(std::move(specs), &LevelSupply::make));
+}
@@ -0,0 +1,52 @@
+#ifndef LEVELSUPPLY_H
+#define LEVELSUPPLY_H
+
+#include "levelgen.h"
+#include <QFutureWatcher>
+#include <deque>
+#include <functional>
+#include <memory>
+
+// Generated levels for New Game. A few are kept ready, made on the thread
+// pool in parallel (read from the cache or generated into it), so taking one
+// costs nothing on the GUI thread. Seeds are drawn from a fixed range, so
+// over time most layouts come straight from the disk cache. Nothing here
+// ever waits for the pool, bar the destructor.
+class LevelSupply
+{
+public:
+    static const int Ahead = 4;     // levels kept ready
+    static const int Seeds = 1000;  // layouts per style, size and density
+
+    LevelSupply();
+    ~LevelSupply();
+
+    // What to make; a change drops the levels made for the old spec. A batch
+    // still being made for it is cancelled and its results ignored.
+    void configure(LevelStyle style, int density, int cols, int rows);
+    bool isConfigured() const { return configured; }
+    const LevelSpec& current() const { return spec; }
+
+    // A ready level, or null if none is ready yet; then onReady is called
+    // on the GUI thread as soon as one is
+    std::shared_ptr<const Level> take();
+    void setReadyHandler(std::function<void()> handler) { onReady = std::move(handler); }
+
+private:
+    struct Made {
+        LevelSpec spec;
+        std::shared_ptr<const Level> level;
+    };
+
+    static Made make(const LevelSpec& spec);
+    static bool sameLayouts(const LevelSpec& a, const LevelSpec& b); // everything but the seed
+    void refill();
+
+    LevelSpec spec;
+    bool configured = false;
+    std::deque<std::shared_ptr<const Level>> ready;
+    QFutureWatcher<Made> watcher;
+    std::function<void()> onReady;
+};
+
+#endif // LEVELSUPPLY_H
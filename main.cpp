@@ -1,11 +1,470 @@
 #include "mainwindow.h"
+#include "alloccount.h"
+#include "arenaclient.h"
+#include "arenaserver.h"
+#include "autopilot.h"
+#include "batchrunner.h"
+#include "frameexport.h"
+#include "levelfiles.h"
+#include "workpool.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QTimer>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+// Re-simulates a replay as fast as possible and checks its claimed result
+static int runHeadlessReplay(const Replay& replay) {
+    QElapsedTimer clock;
+    clock.start();
+    const ReplayOutcome outcome = simulateReplay(replay);
+    const double seconds = clock.nsecsElapsed() / 1e9;
+    const bool verified = verifyReplay(replay);
+
+    std::printf("player %s, %s %s\n", replay.player.c_str(), replay.mode.c_str(), replay.difficulty.c_str());
+    std::printf("score %d (claimed %d), ticks %u (claimed %u), %s\n", outcome.score, replay.claimedScore,
+                outcome.ticks, replay.claimedTicks, verified ? "verified" : "NOT verified");
+    std::printf("simulated %.3f s of play in %.3f ms (%.0f ticks/s)\n", outcome.ticks * replay.tickMs / 1000.0,
+                seconds * 1000, seconds > 0 ? outcome.ticks / seconds : 0.0);
+    return verified ? 0 : 1;
+}
+
+// Plays autopilot games on every mode without a window and reports planning
+// time per tick, bucketed by how much of the free board the snake fills
+static int runAutopilotBench(int games) {
+    const int buckets = 10;
+    const uint32_t tickLimit = 200000; // a game that stalls forever still ends
+    const double budgetUs = 55000; // one Hard tick
+    double worstUs = 0;
+
+    for (const char* mode : { "Mode_1", "Mode_2", "Mode_3" }) {
+        GameConfig config;
+        config.level = loadLevelFile(mode);
+        int64_t plans[buckets] = {};
+        int64_t totalNs[buckets] = {};
+        int64_t maxNs[buckets] = {};
+        int64_t scores = 0;
+        bool cycle = false;
+
+        for (int game = 0; game < games; ++game) {
+            config.seed = static_cast<uint64_t>(game) + 1;
+            GameEngine engine(config);
+            engine.start();
+            Autopilot pilot;
+            pilot.reset(engine);
+            cycle = pilot.usesCycle();
+            const int freeCells = static_cast<int>(std::count(engine.cells(), engine.cells() + engine.columns() * engine.rows(),
+                                                               CellKind::Empty)) + engine.snake().size();
+
+            for (uint32_t tick = 1; !engine.isOver() && tick <= tickLimit; ++tick) {
+                const int bucket = std::min(buckets - 1, engine.snake().size() * buckets / freeCells);
+                const int64_t before = pilot.stats().totalNs;
+                const Direction turn = pilot.plan(engine);
+                const int64_t ns = pilot.stats().totalNs - before;
+                ++plans[bucket];
+                totalNs[bucket] += ns;
+                maxNs[bucket] = std::max(maxNs[bucket], ns);
+                engine.step({ turn, static_cast<int64_t>(tick) * 55 });
+            }
+            scores += engine.score();
+        }
+
+        std::printf("%s (%s), %d games, mean score %.1f\n", mode, cycle ? "cycle" : "search", games,
+                    static_cast<double>(scores) / games);
+        std::printf("  length %%   plans      mean us   max us\n");
+        for (int b = 0; b < buckets; ++b) {
+            if (!plans[b])
+                continue;
+            std::printf("  %3d-%3d%%  %9lld  %9.2f  %8.1f\n", b * 100 / buckets, (b + 1) * 100 / buckets,
+                        static_cast<long long>(plans[b]), totalNs[b] / 1e3 / plans[b], maxNs[b] / 1e3);
+            worstUs = std::max(worstUs, maxNs[b] / 1e3);
+        }
+    }
+    std::printf("worst plan %.1f us, %.2f%% of the 55 ms Hard tick\n", worstUs, worstUs * 100 / budgetUs);
+    return 0;
+}
+
+// Every combination of the listed modes, intervals and bomb settings, each
+// played gamesPerPoint times across all cores; the CSV goes to out or stdout
+static int runBatchSweep(const QCommandLineParser& parser, const BatchSettings& settings, const QString& out) {
+    auto values = [&parser](const QString& name) { return parser.value(name).split(',', Qt::SkipEmptyParts); };
+
+    std::vector<BatchPoint> points;
+    for (const QString& mode : values("modes")) {
+        const std::shared_ptr<const Level> level = loadLevelFile(mode.trimmed());
+        if (!level && mode.trimmed() != "Mode_1") {
+            std::fprintf(stderr, "No level for mode %s\n", qPrintable(mode.trimmed()));
+            return 1;
+        }
+        for (const QString& interval : values("intervals"))
+            for (const QString& probability : values("bomb-probability"))
+                for (const QString& fuse : values("bomb-fuse-ms"))
+                    for (const QString& cooldown : values("bomb-cooldown-ms")) {
+                        BatchPoint point;
+                        point.mode = mode.trimmed().toStdString();
+                        point.level = level;
+                        point.tickMs = std::max(1, interval.toInt());
+                        point.bombProbability = probability.toDouble();
+                        point.bombFuseMs = fuse.toInt();
+                        point.bombCooldownMs = cooldown.toInt();
+                        points.push_back(point);
+                    }
+    }
+    if (points.empty()) {
+        std::fprintf(stderr, "Nothing to run\n");
+        return 1;
+    }
+
+    const BatchRun run = runBatch(points, settings);
+    const QByteArray csv = QByteArray::fromStdString(batchCsv(points, run));
+    if (out.isEmpty()) {
+        std::fwrite(csv.constData(), 1, static_cast<size_t>(csv.size()), stdout);
+    }
+    else {
+        QFile file(out);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(csv) != csv.size()) {
+            std::fprintf(stderr, "Cannot write %s\n", qPrintable(out));
+            return 1;
+        }
+    }
+
+    const int64_t games = static_cast<int64_t>(points.size()) * settings.gamesPerPoint;
+    std::fprintf(stderr, "%lld games at %zu points on %d threads in %.2f s: %.0f games/s, %.2f M ticks/s\n",
+                 static_cast<long long>(games), points.size(), run.threads, run.seconds,
+                 run.seconds > 0 ? games / run.seconds : 0.0, run.seconds > 0 ? run.ticks / run.seconds / 1e6 : 0.0);
+    return 0;
+}
+
+static int runFrameExport(const Replay& replay, const FrameExportSettings& settings) {
+    const FrameExportResult result = exportReplayFrames(replay, settings);
+    if (!result.ok) {
+        std::fprintf(stderr, "Frame export failed: %s\n", qPrintable(result.error));
+        return 1;
+    }
+    std::printf("%lld frames of %dx%d (%s) to %s on %d threads in %.2f s: %.0f frames/s, %.1f MB, "
+                "at most %d frames queued\n",
+                static_cast<long long>(result.frames), result.width, result.height,
+                settings.format == FrameFormat::Rgba ? "raw RGBA8888" : "PNG", qPrintable(settings.directory),
+                result.threads, result.seconds, result.seconds > 0 ? result.frames / result.seconds : 0.0,
+                result.bytes / 1e6, result.peakQueued);
+    return 0;
+}
+
+// Fills the level cache with seeds 1..count of one style, size and density,
+// on all cores, checking every layout as it is read back or generated
+static int runLevelGeneration(const LevelSpec& spec, int count, int threads) {
+    WorkStealingPool pool(threads);
+    std::atomic<int> failed(0);
+    std::atomic<int64_t> walls(0);
+    QElapsedTimer clock;
+    clock.start();
+    pool.run(static_cast<size_t>(count), [&](size_t job, int) {
+        LevelSpec seeded = spec;
+        seeded.seed = job + 1;
+        const std::shared_ptr<const Level> level = loadGeneratedLevel(seeded);
+        if (!level || !levelConnected(*level)) {
+            ++failed;
+            return;
+        }
+        walls += std::count(level->walls.begin(), level->walls.end(), 1);
+    });
+    const double seconds = clock.nsecsElapsed() / 1e9;
+
+    const int made = count - failed;
+    std::printf("%d %s levels of %dx%d at %d%% on %d threads in %.2f s: %.0f levels/s, mean density %.1f%%, "
+                "%d failed\n",
+                made, levelStyleName(spec.style), spec.cols, spec.rows, spec.density, pool.threadCount(), seconds,
+                seconds > 0 ? count / seconds : 0.0,
+                made > 0 ? 100.0 * walls / (static_cast<double>(made) * spec.cols * spec.rows) : 0.0,
+                failed.load());
+    return failed == 0 ? 0 : 1;
+}
+
+static void printArenaStats(const ArenaServer& server) {
+    const ArenaServerStats& stats = server.stats();
+    std::printf("%lld ticks, %d clients: tick message mean %.1f bytes (max %lld), sent %.1f kB/tick; "
+                "tick work p50 %.0f us, p99 %.0f us; jitter mean %.2f ms, max %.2f ms, missed %lld\n",
+                static_cast<long long>(stats.ticks), server.clientCount(), stats.meanFrameBytes(),
+                static_cast<long long>(stats.maxFrameBytes), stats.ticks ? stats.sentBytes / 1e3 / stats.ticks : 0.0,
+                stats.percentileUs(50), stats.percentileUs(99), stats.clock.meanJitterMs(),
+                stats.clock.maxJitterNs / 1e6, static_cast<long long>(stats.clock.missed));
+    std::fflush(stdout);
+}
+
+// A multi-snake server on loopback (and a local socket, if named) that runs
+// until killed, with bots in-process to play against, reporting every 5 s
+static int runArenaServer(const ArenaConfig& config, quint16 port, const QString& socketName, int bots) {
+    ArenaServer server(config, 55);
+    if (!server.listenTcp(port) || (!socketName.isEmpty() && !server.listenLocal(socketName))) {
+        std::fprintf(stderr, "Cannot listen: %s\n", qPrintable(server.errorString()));
+        return 1;
+    }
+    std::printf("arena %dx%d on 127.0.0.1:%u%s%s, %d bots\n", 2 * config.halfCols, 2 * config.halfRows,
+                server.tcpPort(), socketName.isEmpty() ? "" : " and local socket ", qPrintable(socketName), bots);
+    server.start();
+    for (int i = 0; i < bots; ++i)
+        (new ArenaClient(ArenaClient::Role::Bot, static_cast<uint64_t>(i) + 1, &server))->connectTcp(server.tcpPort());
+
+    QTimer report;
+    QObject::connect(&report, &QTimer::timeout, &server, [&server] {
+        printArenaStats(server);
+        server.resetStats();
+    });
+    report.start(5000);
+    return QCoreApplication::exec();
+}
+
+// Bots and spectators all connected over loopback TCP to one server, run for
+// a while; then every spectator's board is checked against the server's
+static int runArenaBench(const ArenaConfig& config, int bots, int spectators, int seconds) {
+    ArenaServer server(config, 55);
+    if (!server.listenTcp(0)) {
+        std::fprintf(stderr, "Cannot listen: %s\n", qPrintable(server.errorString()));
+        return 1;
+    }
+    std::vector<ArenaClient*> watchers;
+    for (int i = 0; i < bots; ++i)
+        (new ArenaClient(ArenaClient::Role::Bot, static_cast<uint64_t>(i) + 1, &server))->connectTcp(server.tcpPort());
+    for (int i = 0; i < spectators; ++i) {
+        watchers.push_back(new ArenaClient(ArenaClient::Role::Spectator, 0, &server));
+        watchers.back()->connectTcp(server.tcpPort());
+    }
+
+    std::printf("arena %dx%d, %d bots, %d spectators over loopback TCP, 55 ms ticks for %d s\n",
+                2 * config.halfCols, 2 * config.halfRows, bots, spectators, seconds);
+    QEventLoop loop;
+    server.start();
+    QTimer::singleShot(seconds * 1000, &loop, &QEventLoop::quit);
+    loop.exec();
+    server.stop();
+
+    // Let the last ticks drain before comparing boards
+    QElapsedTimer drain;
+    drain.start();
+    const uint32_t last = server.arena().tick();
+    auto caughtUp = [&] {
+        return std::all_of(watchers.begin(), watchers.end(),
+                           [last](const ArenaClient* c) { return c->failed() || c->board().tick() >= last; });
+    };
+    while (!caughtUp() && drain.elapsed() < 5000)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+
+    const ArenaEngine& arena = server.arena();
+    int inSync = 0;
+    int64_t received = 0;
+    for (const ArenaClient* watcher : watchers) {
+        received += watcher->receivedBytes();
+        const std::vector<CellKind>& cells = watcher->board().cells();
+        inSync += !watcher->failed() && watcher->board().tick() == last
+                  && cells.size() == static_cast<size_t>(arena.columns()) * arena.rows()
+                  && std::equal(cells.begin(), cells.end(), arena.cells());
+    }
+    int alive = 0;
+    for (const ArenaSnake& snake : arena.snakes())
+        alive += snake.alive;
+
+    printArenaStats(server);
+    std::printf("snakes alive %d, dropped clients %lld, spectators received %.1f MB, in sync %d/%d\n", alive,
+                static_cast<long long>(server.stats().dropped), received / 1e6, inSync, spectators);
+    return inSync == spectators ? 0 : 1;
+}
 
 int main(int argc, char *argv[])
 {
+    QElapsedTimer launch;
+    launch.start();
+    // Frame export and the allocation check never open a window, so they run without a display
+    for (int i = 1; i < argc; ++i) {
+        if ((std::strcmp(argv[i], "--export-frames") == 0 || std::strcmp(argv[i], "--alloc-check") == 0)
+            && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
     QApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption startupMetrics("startup-metrics", "Report time to first frame and time to interactive, then quit.");
+    QCommandLineOption replayFile("replay", "Play back a recorded game.", "file");
+    QCommandLineOption speed("speed", "Playback speed multiplier for --replay (default 1).", "factor", "1");
+    QCommandLineOption headless("headless", "With --replay: re-simulate at full speed without a window and verify it.");
+    QCommandLineOption autopilot("autopilot", "Let the computer play, starting a new game after each one (soak test).");
+    QCommandLineOption autopilotBench("autopilot-bench", "Time autopilot planning over headless games on every mode, then quit.");
+    QCommandLineOption games("games", "Games per mode for --autopilot-bench (default 5), or per point for --batch (default 1000).",
+                             "count");
+    QCommandLineOption batch("batch", "Play headless games across all cores for every combination of the sweep options "
+                                      "below and write survival, score and bomb-death statistics as CSV.");
+    QCommandLineOption modes("modes", "Modes to sweep.", "list", "Mode_1,Mode_2,Mode_3");
+    QCommandLineOption intervals("intervals", "Tick intervals (ms) to sweep.", "list", "85,70,55");
+    QCommandLineOption bombProbability("bomb-probability", "Per-tick bomb chances to sweep.", "list", "0.1,0.3,0.5");
+    QCommandLineOption bombFuse("bomb-fuse-ms", "Bomb lifetimes (ms) to sweep.", "list", "12000");
+    QCommandLineOption bombCooldown("bomb-cooldown-ms", "Times from one bomb to the next (ms) to sweep.", "list", "20000");
+    QCommandLineOption threads("threads", "Worker threads for --batch, --export-frames and --generate-levels (default: "
+                                          "one per core).",
+                               "count", "0");
+    QCommandLineOption maxTicks("max-ticks", "Ticks after which a --batch game counts as survived.", "count", "20000");
+    QCommandLineOption player("player", "Who plays --batch games: greedy (close to a casual player) or autopilot.",
+                              "name", "greedy");
+    QCommandLineOption seed("seed", "Base seed for --batch (the same seed gives the same CSV) and the arena.", "number", "1");
+    QCommandLineOption out("out", "CSV file for --batch (default stdout).", "file");
+    QCommandLineOption board("board", "Board size in cells, e.g. 1000x1000; boards larger than the window scroll with "
+                                      "the snake.", "colsxrows");
+    QCommandLineOption fresh("fresh", "Ignore the game saved when the window was last closed.");
+    QCommandLineOption snapshotEvery("snapshot-every", "Ticks between background saves of the running game "
+                                                       "(0: save only on close).", "ticks", "100");
+    QCommandLineOption serve("serve", "Run a multi-snake server on loopback TCP until killed, reporting bytes per tick "
+                                      "and tick latency every 5 s.");
+    QCommandLineOption port("port", "TCP port for --serve (default 7777).", "port", "7777");
+    QCommandLineOption socketName("socket", "Also serve on this local socket (Unix socket / named pipe).", "name");
+    QCommandLineOption bots("bots", "Bot players for --serve (default 0) or --arena-bench (default 32).", "count");
+    QCommandLineOption arenaBench("arena-bench", "Run the multi-snake server with bots and spectators over loopback, "
+                                                 "check every spectator's board, report and quit.");
+    QCommandLineOption spectators("spectators", "Spectators for --arena-bench (default 300).", "count", "300");
+    QCommandLineOption seconds("seconds", "How long --arena-bench runs (default 10).", "seconds", "10");
+    QCommandLineOption exportFrames("export-frames", "With --replay: render every tick to images in directory, on all "
+                                                     "cores, and quit.", "directory");
+    QCommandLineOption frameFormat("format", "Image format for --export-frames: png, or rgba (raw RGBA8888 frames back "
+                                             "to back in one file).", "name", "png");
+    QCommandLineOption cellSize("cell-size", "Pixels per board cell for --export-frames (default 15).", "pixels", "15");
+    QCommandLineOption maxBombs("bombs", "Bombs on the board at once, each on its own fuse (default 1).", "count", "1");
+    QCommandLineOption foodLifetime("food-lifetime-ms", "Uneaten food moves elsewhere after this long (default 0: never).",
+                                    "ms", "0");
+    QCommandLineOption powerUps("power-ups", "Per-tick chance of a speed or shrink power-up appearing (default 0).",
+                                "probability", "0");
+    QCommandLineOption levels("levels", "Play generated layouts, maze or obstacles, in place of the mode's level.",
+                              "style");
+    QCommandLineOption levelDensity("level-density", "Percentage of the board that generated layouts wall off "
+                                                     "(default 20).", "percent", "20");
+    QCommandLineOption generateLevels("generate-levels", "Generate layouts for seeds 1..count of --levels (default "
+                                                         "maze) into the level cache on all cores, and quit.", "count");
+    QCommandLineOption allocCheck("alloc-check", "Play a scripted game on every mode through the game's tick path and "
+                                                 "fail if any tick after the warm-up allocates (needs qmake "
+                                                 "CONFIG+=alloccount).");
+    QCommandLineOption checkTicks("check-ticks", "Ticks per mode for --alloc-check (default 5000).", "count", "5000");
+    parser.addOptions({ startupMetrics, replayFile, speed, headless, autopilot, autopilotBench, games, batch, modes,
+                        intervals, bombProbability, bombFuse, bombCooldown, threads, maxTicks, player, seed, out,
+                        board, fresh, snapshotEvery, serve, port, socketName, bots, arenaBench, spectators,
+                        seconds, exportFrames, frameFormat, cellSize, maxBombs, foodLifetime, powerUps, levels,
+                        levelDensity, generateLevels, allocCheck, checkTicks });
+    parser.process(a);
+
+    if (parser.isSet(autopilotBench))
+        return runAutopilotBench(std::max(1, parser.isSet(games) ? parser.value(games).toInt() : 5));
+    if (parser.isSet(batch)) {
+        BatchSettings settings;
+        if (parser.isSet(games))
+            settings.gamesPerPoint = std::max(1, parser.value(games).toInt());
+        settings.threads = parser.value(threads).toInt();
+        settings.maxTicks = parser.value(maxTicks).toUInt();
+        settings.player = parser.value(player) == "autopilot" ? BatchPlayer::Autopilot : BatchPlayer::Greedy;
+        settings.seed = parser.value(seed).toULongLong();
+        return runBatchSweep(parser, settings, parser.value(out));
+    }
+
+    int boardCols = 0;
+    int boardRows = 0;
+    if (parser.isSet(board)) {
+        const QStringList size = parser.value(board).split('x');
+        // The snake starts five cells long across the middle, so a side needs six
+        if (size.size() != 2 || size[0].toInt() < 6 || size[1].toInt() < 6) {
+            std::fprintf(stderr, "Board size must look like 1000x1000, at least 6x6\n");
+            return 1;
+        }
+        boardCols = size[0].toInt();
+        boardRows = size[1].toInt();
+        if (static_cast<long long>(boardCols) * boardRows > MaxBoardCells) {
+            std::fprintf(stderr, "A board may have at most %d cells, e.g. 2048x2048\n", MaxBoardCells);
+            return 1;
+        }
+    }
+    LevelStyle levelStyle = LevelStyle::Maze;
+    if (parser.isSet(levels) && !parseLevelStyle(parser.value(levels).toStdString(), levelStyle)) {
+        std::fprintf(stderr, "Level style must be maze or obstacles\n");
+        return 1;
+    }
+    if (parser.isSet(generateLevels)) {
+        LevelSpec spec;
+        spec.style = levelStyle;
+        spec.density = std::clamp(parser.value(levelDensity).toInt(), 0, 100);
+        if (boardCols > 0) {
+            spec.cols = boardCols;
+            spec.rows = boardRows;
+        }
+        return runLevelGeneration(spec, std::max(1, parser.value(generateLevels).toInt()),
+                                  parser.value(threads).toInt());
+    }
+    if (parser.isSet(serve) || parser.isSet(arenaBench)) {
+        ArenaConfig config;
+        config.halfCols = boardCols > 0 ? boardCols / 2 : 60;
+        config.halfRows = boardRows > 0 ? boardRows / 2 : 40;
+        config.seed = parser.value(seed).toULongLong();
+        config.rules.maxBombs = std::max(0, parser.value(maxBombs).toInt());
+        config.rules.foodLifetimeMs = std::max(0, parser.value(foodLifetime).toInt());
+        if (parser.isSet(arenaBench))
+            return runArenaBench(config, parser.isSet(bots) ? parser.value(bots).toInt() : 32,
+                                 parser.value(spectators).toInt(), std::max(1, parser.value(seconds).toInt()));
+        return runArenaServer(config, static_cast<quint16>(parser.value(port).toUInt()), parser.value(socketName),
+                              parser.value(bots).toInt());
+    }
+
+    if (parser.isSet(allocCheck)) {
+        if (!AllocCount::Enabled) {
+            std::fprintf(stderr, "Allocation counting is not built in (qmake CONFIG+=alloccount)\n");
+            return 1;
+        }
+        MainWindow w;
+        return w.checkAllocations(std::max(1, parser.value(checkTicks).toInt())) == 0 ? 0 : 1;
+    }
+
+    if (parser.isSet(exportFrames) && !parser.isSet(replayFile)) {
+        std::fprintf(stderr, "--export-frames needs a --replay to render\n");
+        return 1;
+    }
+
+    Replay replay;
+    if (parser.isSet(replayFile)) {
+        QFile file(parser.value(replayFile));
+        const QByteArray data = file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+        if (!decodeReplay(data.constData(), static_cast<size_t>(data.size()), replay)) {
+            std::fprintf(stderr, "Cannot read replay %s\n", qPrintable(parser.value(replayFile)));
+            return 1;
+        }
+        if (parser.isSet(headless))
+            return runHeadlessReplay(replay);
+        if (parser.isSet(exportFrames)) {
+            FrameExportSettings settings;
+            settings.directory = parser.value(exportFrames);
+            settings.format = parser.value(frameFormat) == "rgba" ? FrameFormat::Rgba : FrameFormat::Png;
+            settings.cellSize = parser.value(cellSize).toInt();
+            settings.threads = parser.value(threads).toInt();
+            return runFrameExport(replay, settings);
+        }
+    }
+
     MainWindow w;
+    if (parser.isSet(board))
+        w.setBoardSize(boardCols, boardRows);
+    w.setSnapshotInterval(parser.value(snapshotEvery).toInt());
+    GameRules rules;
+    rules.maxBombs = std::max(0, parser.value(maxBombs).toInt());
+    rules.foodLifetimeMs = std::max(0, parser.value(foodLifetime).toInt());
+    rules.powerUpProbability = std::clamp(parser.value(powerUps).toDouble(), 0.0, 1.0);
+    w.setRules(rules);
+    if (parser.isSet(levels))
+        w.setGeneratedLevels(levelStyle, std::clamp(parser.value(levelDensity).toInt(), 0, 100));
+    if (parser.isSet(startupMetrics))
+        w.reportStartup(launch);
     w.show();
+    if (!parser.isSet(fresh) && !parser.isSet(autopilot) && !parser.isSet(replayFile))
+        QTimer::singleShot(0, &w, &MainWindow::resumeSavedGame); // after the intro has been set going
+    if (parser.isSet(autopilot) && !parser.isSet(replayFile))
+        w.setAutopilot(true);
+    if (parser.isSet(replayFile) && !w.playReplay(replay, parser.value(speed).toDouble()))
+        return 1;
     return a.exec();
 }
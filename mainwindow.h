@@ -2,7 +2,20 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <deque>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QImage>
+#include "autopilot.h"
+#include "boardwidget.h"
+#include "fixedstep.h"
+#include "gameengine.h"
+#include "highscorestore.h"
+#include "inputqueue.h"
+#include "levelsupply.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "trace.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -10,6 +23,8 @@ namespace Ui {
 }
 QT_END_NAMESPACE
 
+class QLabel;
+
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -17,10 +32,27 @@ class MainWindow : public QMainWindow
 public:
     MainWindow(QWidget* parent = nullptr);
     ~MainWindow();
+    void reportStartup(const QElapsedTimer& sinceLaunch);
+    bool playReplay(const Replay& replay, double speed);
+    void setAutopilot(bool enabled);
+    void setBoardSize(int cols, int rows);
+    void setSnapshotInterval(int ticks);
+    void setRules(const GameRules& rules);
+    void setGeneratedLevels(LevelStyle style, int density);
+    bool resumeSavedGame();
+    int checkAllocations(int ticks);
+signals:
+    void gameEnded();         // the tick that ended the game, before its results are handled
+    void highScoresUpdated(); // the finished game is ranked and on the leaderboard
 protected:
     void keyPressEvent(QKeyEvent* event) override;
+    void closeEvent(QCloseEvent* event) override;
 private slots:
     void on_New_Game_clicked();
+    void advanceIntro();
+    void onFramePainted();
+    void ensureHighScoresLoaded();
+    void startAutopilotGame();
 
 private:
     int gridOffset = 15;
@@ -31,37 +63,100 @@ private:
     int started = -1;
     int elapsedTime = 0;
     int score;
-    int interval = 500;
+    int interval = 85;
+    int boardCols = 0;            // fixed board size (--board), 0 = whatever fits the window
+    int boardRows = 0;
+    GameRules rules;              // bombs at once, expiring food, power-ups
+    bool generatedLevels = false; // New Game plays generated layouts in place of the mode's level
+    LevelStyle levelStyle = LevelStyle::Maze;
+    int levelDensity = 20;
+    LevelSupply levelSupply;
+    bool awaitingLevel = false;   // New Game is waiting for a generated level to be ready
     QTimer* timer;
-    QTimer* gameTimer;
-    std::deque<QPoint> snake;
-    QSet<QPoint> snakePoints;
-    QVector<int> direction = { 0, 0 };
+    GameEngine engine;
+    QElapsedTimer gameClock;      // monotonic clock the tick deadlines are measured on
+    FixedStepClock stepClock;
+    InputQueue inputs;
+    QElapsedTimer inputClock;     // timestamps key presses for the latency figures
+    LatencyStats tickLatency;     // key press to the tick that applied it
+    LatencyStats frameLatency;    // key press to the first frame showing it
+    qint64 awaitingFrame[InputQueue::Capacity];
+    int awaitingFrameCount = 0;
+    BoardMotion tickMotion;       // the latest tick's moves, drawn in between ticks
+    qint64 framesPainted = 0;     // while the game runs, for the frame rate
+    enum class BombNotice { None, Alert, Diffused };
+    BombNotice bombNotice = BombNotice::None;
+    int shownScore = -1;          // what the HUD labels show, so a tick only sets the ones that changed
+    BombNotice shownNotice = BombNotice::None;
+    QString scoreTexts[2];        // the score label's text, written in place by turns
+    int scoreSlot = 0;
+    QString watchTexts[2];        // the stopwatch's, likewise
+    int watchSlot = 0;
+    qint64 allocatingTicks = 0;   // ticks that allocated, with CONFIG+=alloccount
+    uint64_t mostTickAllocations = 0;
+    Replay recording;             // the game in progress, or the one being played back
+    bool replaying = false;
+    size_t playbackNext = 0;
+    Autopilot autopilot;
+    bool autopilotEnabled = false;
+    qint64 tickBase = 0;          // ticks played before a resume; the step clock counts from there
+    int snapshotEvery = 100;      // ticks between background saves of the running game, 0 = only on close
+    qint64 lastSnapshotTick = 0;
+    QFuture<void> snapshotWrite;
     Ui::MainWindow* ui;
-    void colorPointAbsolute(int x, int y, int r, int g, int b, int penwidth);
-    void colorPointRelative(int x, int y, int r, int g, int b);
-    void delay(int ms);
-    QPoint food;
+    QTimer* levelPlayback;
+    int revealedRows = 0;
+    bool animateLevelBuild = true;
+    void colorCell(Cell cell, CellKind kind);
+    void revealLevelRows();
+    void finishLevelPlayback();
+    QString currentMode() const;
+    QString currentDifficulty() const;
+    void boardHalfSize(int& halfCols, int& halfRows) const;
+    void prepareLevels();
     void startGame();
     void moveSnake();
-    QColor getPixelColor(int x, int y);
-    void growFood();
-    void plantBomb();
-    void updateWatch();
-    QSet<QPoint> walls;
-    void createMode2();
-    void createMode3();
-    QVector<QVector<bool>> bitmap;
-    double bombProbability = 0.3;
-    QPoint bomb;
+    void scheduleTick();
+    void stepGame(qint64 tick);
+    void showNewBoard();
+    void saveReplay(const Replay& replay);
+    void saveSnapshot(bool wait);
+    void discardSnapshot();
+    Direction nextTurn();
+    void updateHud(bool force = false);
+    void updateWatch(qint64 tick);
+    void setStopwatch(int seconds);
     //void renderSnakeGameText();
     void drawTextOnWorkArea(const QString& text, int fontSize, QColor color);
     QString playerName;
     void loadHighScores();
-    void saveHighScores();
     void updateHighScores();
-    void updateRankLabels(const QString& key);
-    void initializeHighScoresFile();
+    void updateRankLabels();
     void renderSnakeGameText();
+    void stopIntro();
+    void reportStartupProgress();
+    void exportTrace();
+    void toggleTraceOverlay();
+    void updateTraceOverlay();
+
+    enum class IntroStage { Off, Reveal, Hold };
+    QTimer* introTimer;
+    IntroStage introStage = IntroStage::Off;
+    QImage introText;
+    QRect introRect;
+    int introRow = 0;
+
+    HighScoreStore scoreStore;
+    QFutureWatcher<void>* highScoresLoader = nullptr;
+    Leaderboard loadedHighScores;    // written by the loader thread
+    bool highScoresReady = false;
+
+    QElapsedTimer launchClock;
+    bool startupMetrics = false;
+    qint64 firstFrameMs = -1;
+
+    QLabel* traceOverlay = nullptr;
+    QTimer* overlayTimer = nullptr;
+    std::vector<Trace::Event> traceEvents; // reused by every overlay update
 };
 #endif // MAINWINDOW_H
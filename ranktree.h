@@ -0,0 +1,200 @@
+#ifndef RANKTREE_H
+#define RANKTREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Ordered multiset with order statistics: a treap whose nodes carry their
+// subtree sizes, kept in one vector and linked by index. insert(), the rank
+// of any key and the key at any rank take O(log n) expected; walking k keys
+// in order from a rank costs O(log n + k). Equal keys keep insertion order.
+// Nothing is ever removed, which is all the leaderboard needs.
+template <typename Key, typename Less = std::less<Key>>
+class RankTree
+{
+public:
+    explicit RankTree(Less less = Less()) : less(less) {}
+
+    void clear() {
+        nodes.clear();
+        root = -1;
+    }
+    void reserve(size_t count) { nodes.reserve(count); }
+    size_t size() const { return nodes.size(); }
+    bool empty() const { return nodes.empty(); }
+
+    // Replaces the contents with keys (equal ones in the order given): a sort
+    // and a linear build, far quicker than inserting a long history one by
+    // one
+    void assign(std::vector<Key> keys) {
+        std::stable_sort(keys.begin(), keys.end(), less);
+        nodes.clear();
+        nodes.reserve(keys.size());
+        for (const Key& key : keys)
+            nodes.push_back({ key, 0, -1, -1, 1 });
+        root = build(0, static_cast<int>(nodes.size()), 0);
+    }
+
+    // Returns how many keys now come before the new one
+    size_t insert(const Key& key) {
+        const int node = static_cast<int>(nodes.size());
+        nodes.push_back({ key, nextPriority(), -1, -1, 1 });
+        int before = -1;
+        int after = -1;
+        split(root, key, before, after);
+        const size_t rank = sizeOf(before);
+        root = merge(merge(before, node), after);
+        return rank;
+    }
+
+    // Number of leading keys for which before(key) holds; before must hold
+    // for a prefix of the order and fail for the rest, as with
+    // std::partition_point
+    template <typename Before>
+    size_t countBefore(Before&& before) const {
+        size_t count = 0;
+        int node = root;
+        while (node >= 0) {
+            const Node& n = nodes[node];
+            if (before(n.key)) {
+                count += sizeOf(n.left) + 1;
+                node = n.right;
+            }
+            else {
+                node = n.left;
+            }
+        }
+        return count;
+    }
+
+    // The key at 0-based rank, which must be below size()
+    const Key& at(size_t rank) const {
+        int node = root;
+        while (true) {
+            const Node& n = nodes[node];
+            const size_t left = sizeOf(n.left);
+            if (rank < left) {
+                node = n.left;
+            }
+            else if (rank == left) {
+                return n.key;
+            }
+            else {
+                rank -= left + 1;
+                node = n.right;
+            }
+        }
+    }
+
+    // Calls visit(key) for up to count keys in order, starting at rank first
+    template <typename Visit>
+    void visit(size_t first, size_t count, Visit&& visit) const {
+        // The path down to first, keeping the nodes still to be visited
+        path.clear();
+        int node = root;
+        while (node >= 0) {
+            const Node& n = nodes[node];
+            const size_t left = sizeOf(n.left);
+            if (first < left) {
+                path.push_back(node);
+                node = n.left;
+            }
+            else if (first == left) {
+                path.push_back(node);
+                break;
+            }
+            else {
+                first -= left + 1;
+                node = n.right;
+            }
+        }
+        while (count > 0 && !path.empty()) {
+            node = path.back();
+            path.pop_back();
+            visit(nodes[node].key);
+            --count;
+            for (node = nodes[node].right; node >= 0; node = nodes[node].left)
+                path.push_back(node);
+        }
+    }
+
+private:
+    struct Node {
+        Key key;
+        uint32_t priority;
+        int left;
+        int right;
+        uint32_t size;
+    };
+
+    size_t sizeOf(int node) const { return node >= 0 ? nodes[node].size : 0; }
+    void update(int node) {
+        Node& n = nodes[node];
+        n.size = static_cast<uint32_t>(sizeOf(n.left) + sizeOf(n.right) + 1);
+    }
+
+    // xorshift32: the shape is random enough to stay balanced and the same
+    // on every run
+    uint32_t nextPriority() {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    // A balanced tree over nodes[begin, end). Priorities fall with depth, so
+    // it is a valid treap for later inserts to go on from.
+    int build(int begin, int end, int depth) {
+        if (begin >= end)
+            return -1;
+        const int middle = begin + (end - begin) / 2;
+        nodes[middle].priority = static_cast<uint32_t>(31 - std::min(depth, 31)) << 27 | nextPriority() >> 5;
+        nodes[middle].left = build(begin, middle, depth + 1);
+        nodes[middle].right = build(middle + 1, end, depth + 1);
+        update(middle);
+        return middle;
+    }
+
+    // Keys not after key go left, so a new key lands behind its equals
+    void split(int node, const Key& key, int& left, int& right) {
+        if (node < 0) {
+            left = right = -1;
+            return;
+        }
+        if (less(key, nodes[node].key)) {
+            split(nodes[node].left, key, left, nodes[node].left);
+            right = node;
+        }
+        else {
+            split(nodes[node].right, key, nodes[node].right, right);
+            left = node;
+        }
+        update(node);
+    }
+
+    int merge(int left, int right) {
+        if (left < 0)
+            return right;
+        if (right < 0)
+            return left;
+        if (nodes[left].priority > nodes[right].priority) {
+            nodes[left].right = merge(nodes[left].right, right);
+            update(left);
+            return left;
+        }
+        nodes[right].left = merge(left, nodes[right].left);
+        update(right);
+        return right;
+    }
+
+    Less less;
+    std::vector<Node> nodes;
+    int root = -1;
+    uint32_t seed = 2463534242u;
+    mutable std::vector<int> path; // scratch for visit()
+};
+
+#endif // RANKTREE_H
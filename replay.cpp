@@ -0,0 +1,186 @@
+#include "replay.h"
+#include "varint.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char Magic[4] = { 'S', 'N', 'K', 'R' };
+const uint8_t Version = 2;
+
+// Limits on what a replay may ask for; anything larger is a corrupt or
+// crafted file, not a game.
+const uint64_t MaxHalfCells = MaxBoardCells / 4; // halfCols * halfRows
+const uint64_t MaxMs = 24ULL * 3600 * 1000;
+const uint64_t MaxCount = 0x7fffffff;    // anything stored in an int
+
+// Stored as its bit pattern, so the replay rolls exactly the same chance
+uint64_t probabilityBits(double p) {
+    uint64_t bits;
+    std::memcpy(&bits, &p, sizeof(bits));
+    return bits;
+}
+
+double probabilityFromBits(uint64_t bits) {
+    double p;
+    std::memcpy(&p, &bits, sizeof(p));
+    return p;
+}
+
+} // namespace
+
+std::string encodeReplay(const Replay& replay) {
+    std::string out(Magic, sizeof(Magic));
+    out += static_cast<char>(Version);
+    putString(out, replay.mode);
+    putString(out, replay.difficulty);
+    putString(out, replay.player);
+    putVarint(out, static_cast<uint64_t>(replay.tickMs));
+    putVarint(out, static_cast<uint64_t>(replay.halfCols));
+    putVarint(out, static_cast<uint64_t>(replay.halfRows));
+    putVarint(out, replay.seed);
+    putString(out, replay.levelText);
+
+    putVarint(out, replay.inputs.size());
+    uint32_t previous = 0;
+    for (const ReplayInput& input : replay.inputs) {
+        const uint64_t delta = input.tick - previous;
+        putVarint(out, delta << 2 | (static_cast<uint64_t>(input.direction) - 1));
+        previous = input.tick;
+    }
+
+    putVarint(out, static_cast<uint64_t>(replay.claimedScore));
+    putVarint(out, replay.claimedTicks);
+
+    const GameRules& rules = replay.rules;
+    putVarint(out, static_cast<uint64_t>(rules.maxBombs));
+    putVarint(out, static_cast<uint64_t>(rules.foodLifetimeMs));
+    putVarint(out, probabilityBits(rules.powerUpProbability));
+    putVarint(out, static_cast<uint64_t>(rules.powerUpLifetimeMs));
+    putVarint(out, static_cast<uint64_t>(rules.speedMs));
+    putVarint(out, static_cast<uint64_t>(rules.shrinkCells));
+    return out;
+}
+
+bool decodeReplay(const char* data, size_t size, Replay& replay) {
+    replay = Replay();
+    if (size < sizeof(Magic) + 1 || std::memcmp(data, Magic, sizeof(Magic)) != 0 || data[4] < 1 || data[4] > Version)
+        return false;
+
+    VarintReader in = { reinterpret_cast<const uint8_t*>(data) + 5, reinterpret_cast<const uint8_t*>(data) + size };
+    replay.mode = in.string();
+    replay.difficulty = in.string();
+    replay.player = in.string();
+    const uint64_t tickMs = in.varint();
+    const uint64_t halfCols = in.varint();
+    const uint64_t halfRows = in.varint();
+    if (!in.ok || tickMs == 0 || tickMs > MaxMs || halfCols <= 2 || halfRows == 0 || halfCols > MaxHalfCells
+        || halfRows > MaxHalfCells || halfCols * halfRows > MaxHalfCells)
+        return false;
+    replay.tickMs = static_cast<int>(tickMs);
+    replay.halfCols = static_cast<int>(halfCols);
+    replay.halfRows = static_cast<int>(halfRows);
+    replay.seed = in.varint();
+    replay.levelText = in.string();
+
+    const uint64_t count = in.varint();
+    if (!in.ok || count > static_cast<uint64_t>(in.end - in.p))
+        return false;
+    replay.inputs.reserve(static_cast<size_t>(count));
+    uint32_t tick = 0;
+    for (uint64_t i = 0; i < count && in.ok; ++i) {
+        const uint64_t packed = in.varint();
+        tick += static_cast<uint32_t>(packed >> 2);
+        replay.inputs.push_back({ tick, static_cast<Direction>((packed & 3) + 1) });
+    }
+
+    const uint64_t claimedScore = in.varint();
+    replay.claimedScore = static_cast<int>(std::min(claimedScore, MaxCount));
+    replay.claimedTicks = static_cast<uint32_t>(in.varint());
+
+    if (data[4] >= 2) {
+        const uint64_t cells = 4 * halfCols * halfRows;
+        const uint64_t maxBombs = in.varint();
+        const uint64_t foodLifetimeMs = in.varint();
+        const uint64_t probability = in.varint();
+        const uint64_t powerUpLifetimeMs = in.varint();
+        const uint64_t speedMs = in.varint();
+        const uint64_t shrinkCells = in.varint();
+        if (maxBombs > cells || foodLifetimeMs > MaxMs || powerUpLifetimeMs > MaxMs || speedMs > MaxMs
+            || shrinkCells > cells)
+            return false;
+        GameRules& rules = replay.rules;
+        rules.maxBombs = static_cast<int>(maxBombs);
+        rules.foodLifetimeMs = static_cast<int>(foodLifetimeMs);
+        rules.powerUpProbability = probabilityFromBits(probability);
+        rules.powerUpLifetimeMs = static_cast<int>(powerUpLifetimeMs);
+        rules.speedMs = static_cast<int>(speedMs);
+        rules.shrinkCells = static_cast<int>(shrinkCells);
+    }
+    return in.ok;
+}
+
+bool replayConfig(const Replay& replay, GameConfig& config) {
+    config = GameConfig();
+    config.halfCols = replay.halfCols;
+    config.halfRows = replay.halfRows;
+    config.seed = replay.seed;
+    config.rules = replay.rules;
+    if (!replay.levelText.empty()) {
+        auto level = std::make_shared<Level>();
+        if (!parseLevel(replay.levelText.data(), replay.levelText.size(), *level) || level->cols > 2 * replay.halfCols
+            || level->rows > 2 * replay.halfRows)
+            return false;
+        config.level = level;
+    }
+    return true;
+}
+
+bool ReplayPlayer::reset(const Replay& replay) {
+    GameConfig config;
+    if (!replayConfig(replay, config))
+        return false;
+    engine.reset(config);
+    engine.start();
+    inputs = replay.inputs;
+    nextInput = 0;
+    ticks = 0;
+    tickMs = replay.tickMs;
+    return true;
+}
+
+const StepResult& ReplayPlayer::step() {
+    ++ticks;
+    Direction turn = Direction::None;
+    if (nextInput < inputs.size() && inputs[nextInput].tick == ticks)
+        turn = inputs[nextInput++].direction;
+    return engine.step({ turn, simulatedMs() });
+}
+
+ReplayOutcome simulateReplay(const Replay& replay, uint32_t tickLimit) {
+    ReplayOutcome outcome;
+    ReplayPlayer player;
+    if (!player.reset(replay))
+        return outcome;
+
+    for (size_t i = 1; i < replay.inputs.size(); ++i) {
+        if (replay.inputs[i].tick <= replay.inputs[i - 1].tick)
+            return outcome; // at most one turn per tick, in order
+    }
+
+    outcome.valid = true;
+    while (!player.finished() && player.tick() < tickLimit) {
+        const StepResult& result = player.step();
+        outcome.boardFull = result.boardFull;
+    }
+    outcome.score = player.game().score();
+    outcome.ticks = player.tick();
+    return outcome;
+}
+
+// A claim holds if re-running the inputs ends the game on the claimed step
+// with the claimed score.
+bool verifyReplay(const Replay& replay) {
+    const ReplayOutcome outcome = simulateReplay(replay, replay.claimedTicks + 1);
+    return outcome.valid && outcome.score == replay.claimedScore && outcome.ticks == replay.claimedTicks;
+}
@@ -0,0 +1,69 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "gameengine.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ReplayInput {
+    uint32_t tick;          // 1-based step the turn was applied on
+    Direction direction;
+};
+
+// Everything needed to re-simulate a game exactly: the board, the seed and
+// the turns. Time is simulated (tick * tickMs), so the result is
+// reproducible no matter how fast the replay is run.
+struct Replay {
+    std::string mode;       // e.g. "Mode_2"
+    std::string difficulty; // e.g. "Hard"
+    std::string player;
+    int tickMs = 85;
+    int halfCols = 30;
+    int halfRows = 25;
+    uint64_t seed = 0;
+    std::string levelText;  // the level as loaded, in .lvl form; empty for an open board
+    GameRules rules;
+    std::vector<ReplayInput> inputs;
+    int claimedScore = 0;
+    uint32_t claimedTicks = 0; // step on which the game ended
+};
+
+struct ReplayOutcome {
+    bool valid = false;     // the replay could be set up (level parsed, inputs in order)
+    int score = 0;
+    uint32_t ticks = 0;
+    bool boardFull = false;
+};
+
+// Binary form: "SNKR", a version byte, then LEB128 varints. Inputs are
+// stored as (tick delta << 2 | direction), so a turn usually costs one byte.
+// Version 2 adds the rules at the end; version 1 replays get the defaults.
+std::string encodeReplay(const Replay& replay);
+bool decodeReplay(const char* data, size_t size, Replay& replay);
+
+bool replayConfig(const Replay& replay, GameConfig& config);
+
+// Steps an engine through a replay's inputs; for playback at any speed.
+class ReplayPlayer
+{
+public:
+    bool reset(const Replay& replay);
+    const StepResult& step();       // one tick with the recorded turn, if any
+    bool finished() const { return engine.isOver(); }
+    uint32_t tick() const { return ticks; }
+    int64_t simulatedMs() const { return static_cast<int64_t>(ticks) * tickMs; }
+    const GameEngine& game() const { return engine; }
+
+private:
+    GameEngine engine;
+    std::vector<ReplayInput> inputs;
+    size_t nextInput = 0;
+    uint32_t ticks = 0;
+    int tickMs = 85;
+};
+
+ReplayOutcome simulateReplay(const Replay& replay, uint32_t tickLimit = 50000000);
+bool verifyReplay(const Replay& replay);
+
+#endif // REPLAY_H
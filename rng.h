@@ -0,0 +1,61 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+// Small seedable generator (xoshiro256**). Every random decision of a game
+// goes through one of these so a game can be re-simulated from its seed.
+class Rng
+{
+public:
+    explicit Rng(uint64_t seed = 0) { reseed(seed); }
+
+    void reseed(uint64_t seed) {
+        // Expand the seed with splitmix64 so that nearby seeds diverge
+        for (uint64_t& word : s) {
+            seed += 0x9E3779B97F4A7C15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next() {
+        const uint64_t result = rotl(s[1] * 5, 7) * 9;
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    // Uniform integer in [0, n)
+    uint32_t bounded(uint32_t n) {
+        return static_cast<uint32_t>(((next() >> 32) * n) >> 32);
+    }
+
+    // Uniform double in [0, 1)
+    double uniform() {
+        return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // Raw generator state, so a game in progress can be saved and resumed
+    void getState(uint64_t out[4]) const {
+        for (int i = 0; i < 4; ++i)
+            out[i] = s[i];
+    }
+    void setState(const uint64_t in[4]) {
+        for (int i = 0; i < 4; ++i)
+            s[i] = in[i];
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    uint64_t s[4];
+};
+
+#endif // RNG_H
@@ -0,0 +1,58 @@
+#ifndef SNAKEBODY_H
+#define SNAKEBODY_H
+
+#include "gametypes.h"
+#include <vector>
+
+// The snake's cells from tail to head in a fixed-capacity ring. The storage is
+// sized once per game to the board's cell count (the longest the snake can
+// ever get), so moving the head and tail never allocates.
+class SnakeBody
+{
+public:
+    class const_iterator
+    {
+    public:
+        const_iterator(const SnakeBody* body, int i) : body(body), i(i) {}
+        const Cell& operator*() const { return body->at(i); }
+        const_iterator& operator++() { ++i; return *this; }
+        bool operator!=(const const_iterator& other) const { return i != other.i; }
+    private:
+        const SnakeBody* body;
+        int i;
+    };
+
+    void reset(int capacity) {
+        cells.assign(capacity, Cell());
+        first = 0;
+        count = 0;
+    }
+
+    int size() const { return count; }
+    int capacity() const { return static_cast<int>(cells.size()); }
+    const Cell& tail() const { return cells[first]; }
+    const Cell& head() const { return at(count - 1); }
+    const Cell& at(int i) const { return cells[wrap(first + i)]; } // 0 is the tail
+
+    void pushHead(Cell c) {
+        cells[wrap(first + count)] = c;
+        ++count;
+    }
+
+    void popTail() {
+        first = wrap(first + 1);
+        --count;
+    }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count); }
+
+private:
+    int wrap(int i) const { return i >= capacity() ? i - capacity() : i; }
+
+    std::vector<Cell> cells;
+    int first = 0;
+    int count = 0;
+};
+
+#endif // SNAKEBODY_H
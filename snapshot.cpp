@@ -0,0 +1,223 @@
+#include "snapshot.h"
+#include "varint.h"
+#include <cstring>
+
+namespace {
+
+const char Magic[4] = { 'S', 'N', 'K', 'S' };
+const uint8_t Version = 2;
+
+// State flags; the bomb ones are from version 1, which had a single bomb
+const uint64_t Over = 1, FoodPlaced = 2, BombPlaced = 4, NextBomb = 8, PowerUpPlaced = 16;
+
+// Version 1 kept one bomb and its planting time, and polled them with the
+// default timings; those turn into the timers the engine now runs on
+void upgradeBombState(EngineState& state, bool bombPlaced, Cell bomb, bool nextBomb, int64_t plantedAt, int64_t nowMs) {
+    const GameConfig defaults;
+    state.clock = nowMs + 1;
+    if (bombPlaced) {
+        state.bombs.push_back(bomb);
+        state.timers.push_back({ plantedAt + defaults.bombFuseMs + 1, { TimedEvent::BombDiffuse, bomb, plantedAt } });
+    }
+    if (nextBomb) {
+        const int64_t alertDue = plantedAt + defaults.bombAlertMs + 1;
+        if (alertDue >= state.clock)
+            state.timers.push_back({ alertDue, { TimedEvent::BombAlertClear, bomb, plantedAt } });
+        state.timers.push_back({ plantedAt + defaults.bombCooldownMs + 1, { TimedEvent::BombCooldownEnd, bomb, plantedAt } });
+    }
+}
+
+// Bits needed for any index below count
+int bitWidth(uint64_t count) {
+    int bits = 1;
+    while (bits < 32 && (uint64_t(1) << bits) < count)
+        ++bits;
+    return bits;
+}
+
+} // namespace
+
+std::string encodeSnapshot(const Snapshot& snapshot) {
+    const EngineState& state = snapshot.state;
+    std::string out(Magic, sizeof(Magic));
+    out += static_cast<char>(Version);
+    putString(out, encodeReplay(snapshot.recording));
+    putVarint(out, snapshot.tick);
+
+    putVarint(out, static_cast<uint64_t>(state.heading));
+    putVarint(out, static_cast<uint64_t>(state.points));
+    putVarint(out, (state.over ? Over : 0) | (state.foodPlaced ? FoodPlaced : 0)
+                       | (state.powerUpPlaced ? PowerUpPlaced : 0));
+    putSigned(out, state.food.x);
+    putSigned(out, state.food.y);
+    putVarint(out, state.bombs.size());
+    for (const Cell& bomb : state.bombs) {
+        putSigned(out, bomb.x);
+        putSigned(out, bomb.y);
+    }
+    if (state.powerUpPlaced) {
+        putSigned(out, state.powerUp.x);
+        putSigned(out, state.powerUp.y);
+        putVarint(out, static_cast<uint64_t>(state.powerUpKind));
+    }
+
+    // Timers in firing order, due times relative to the clock
+    putSigned(out, state.clock);
+    putVarint(out, state.timers.size());
+    for (const auto& timer : state.timers) {
+        putSigned(out, timer.first - state.clock);
+        putVarint(out, static_cast<uint64_t>(timer.second.event));
+        putSigned(out, timer.second.cell.x);
+        putSigned(out, timer.second.cell.y);
+        putSigned(out, timer.first - timer.second.since);
+    }
+    for (uint64_t word : state.rng)
+        for (int shift = 0; shift < 64; shift += 8)
+            out += static_cast<char>(word >> shift); // fixed width, little-endian
+
+    putVarint(out, state.body.size());
+    if (state.body.empty())
+        return out;
+    putSigned(out, state.body.front().x);
+    putSigned(out, state.body.front().y);
+    uint8_t packed = 0;
+    for (size_t i = 1; i < state.body.size(); ++i) {
+        const int code = static_cast<int>(stepDirection(state.body[i - 1], state.body[i])) - 1;
+        packed |= static_cast<uint8_t>(code << ((i - 1) % 4 * 2));
+        if ((i - 1) % 4 == 3 || i + 1 == state.body.size()) {
+            out += static_cast<char>(packed);
+            packed = 0;
+        }
+    }
+
+    // Free cells as fixed-width grid indices, back to back
+    const int bits = bitWidth(4ULL * snapshot.recording.halfCols * snapshot.recording.halfRows);
+    putVarint(out, state.freeOrder.size());
+    uint64_t pending = 0;
+    int pendingBits = 0;
+    for (int cell : state.freeOrder) {
+        pending |= static_cast<uint64_t>(cell) << pendingBits;
+        pendingBits += bits;
+        while (pendingBits >= 8) {
+            out += static_cast<char>(pending);
+            pending >>= 8;
+            pendingBits -= 8;
+        }
+    }
+    if (pendingBits > 0)
+        out += static_cast<char>(pending);
+    return out;
+}
+
+bool decodeSnapshot(const char* data, size_t size, Snapshot& snapshot) {
+    snapshot = Snapshot();
+    if (size < sizeof(Magic) + 1 || std::memcmp(data, Magic, sizeof(Magic)) != 0 || data[4] < 1 || data[4] > Version)
+        return false;
+    const int version = data[4];
+
+    VarintReader in = { reinterpret_cast<const uint8_t*>(data) + 5, reinterpret_cast<const uint8_t*>(data) + size };
+    const std::string recording = in.string();
+    if (!in.ok || !decodeReplay(recording.data(), recording.size(), snapshot.recording))
+        return false;
+    snapshot.tick = static_cast<uint32_t>(in.varint());
+
+    EngineState& state = snapshot.state;
+    const uint64_t heading = in.varint();
+    if (heading > static_cast<uint64_t>(Direction::Down))
+        return false;
+    state.heading = static_cast<Direction>(heading);
+    state.points = static_cast<int>(in.varint());
+    const uint64_t flags = in.varint();
+    state.over = flags & Over;
+    state.foodPlaced = flags & FoodPlaced;
+    state.food.x = static_cast<int>(in.signedVarint());
+    state.food.y = static_cast<int>(in.signedVarint());
+    const uint64_t cells = 4ULL * snapshot.recording.halfCols * snapshot.recording.halfRows;
+    if (version == 1) {
+        Cell bomb;
+        bomb.x = static_cast<int>(in.signedVarint());
+        bomb.y = static_cast<int>(in.signedVarint());
+        const int64_t plantedAt = in.signedVarint();
+        upgradeBombState(state, flags & BombPlaced, bomb, flags & NextBomb, plantedAt,
+                         static_cast<int64_t>(snapshot.tick) * snapshot.recording.tickMs);
+    }
+    else {
+        const uint64_t bombs = in.varint();
+        if (!in.ok || bombs > cells)
+            return false;
+        for (uint64_t i = 0; i < bombs && in.ok; ++i) {
+            Cell bomb;
+            bomb.x = static_cast<int>(in.signedVarint());
+            bomb.y = static_cast<int>(in.signedVarint());
+            state.bombs.push_back(bomb);
+        }
+        state.powerUpPlaced = flags & PowerUpPlaced;
+        if (state.powerUpPlaced) {
+            state.powerUp.x = static_cast<int>(in.signedVarint());
+            state.powerUp.y = static_cast<int>(in.signedVarint());
+            const uint64_t kind = in.varint();
+            if (kind == 0 || kind > static_cast<uint64_t>(PowerUp::Shrink))
+                return false;
+            state.powerUpKind = static_cast<PowerUp>(kind);
+        }
+
+        state.clock = in.signedVarint();
+        const uint64_t timers = in.varint();
+        if (!in.ok || timers > static_cast<uint64_t>(in.end - in.p))
+            return false;
+        for (uint64_t i = 0; i < timers && in.ok; ++i) {
+            const int64_t due = state.clock + in.signedVarint();
+            const uint64_t event = in.varint();
+            if (event > static_cast<uint64_t>(TimedEvent::SpeedEnd))
+                return false;
+            GameTimer timer;
+            timer.event = static_cast<TimedEvent>(event);
+            timer.cell.x = static_cast<int>(in.signedVarint());
+            timer.cell.y = static_cast<int>(in.signedVarint());
+            timer.since = due - in.signedVarint();
+            state.timers.push_back({ due, timer });
+        }
+    }
+    uint8_t rngBytes[32];
+    if (!in.bytes(rngBytes, sizeof(rngBytes)))
+        return false;
+    for (int i = 0; i < 4; ++i)
+        for (int b = 0; b < 8; ++b)
+            state.rng[i] |= static_cast<uint64_t>(rngBytes[i * 8 + b]) << (b * 8);
+
+    const uint64_t length = in.varint();
+    Cell cell;
+    cell.x = static_cast<int>(in.signedVarint());
+    cell.y = static_cast<int>(in.signedVarint());
+    if (!in.ok || length == 0 || length > cells || (length + 2) / 4 > static_cast<uint64_t>(in.end - in.p))
+        return false;
+    state.body.reserve(static_cast<size_t>(length));
+    state.body.push_back(cell);
+    uint8_t packed = 0;
+    for (uint64_t i = 1; i < length && in.ok; ++i) {
+        if ((i - 1) % 4 == 0 && !in.bytes(&packed, 1))
+            break;
+        const Direction step = static_cast<Direction>(((packed >> ((i - 1) % 4 * 2)) & 3) + 1);
+        cell = wrapped({ cell.x + directionX(step), cell.y + directionY(step) }, snapshot.recording.halfCols,
+                       snapshot.recording.halfRows);
+        state.body.push_back(cell);
+    }
+
+    const int bits = bitWidth(cells);
+    const uint64_t freeCount = in.varint();
+    if (!in.ok || freeCount > cells || (freeCount * bits + 7) / 8 > static_cast<uint64_t>(in.end - in.p))
+        return false;
+    state.freeOrder.resize(static_cast<size_t>(freeCount));
+    uint64_t pending = 0;
+    int pendingBits = 0;
+    for (int& free : state.freeOrder) {
+        while (pendingBits < bits) {
+            pending |= static_cast<uint64_t>(*in.p++) << pendingBits;
+            pendingBits += 8;
+        }
+        free = static_cast<int>(pending & ((uint64_t(1) << bits) - 1));
+        pending >>= bits;
+        pendingBits -= bits;
+    }
+    return in.ok;
+}
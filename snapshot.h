@@ -0,0 +1,28 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "gameengine.h"
+#include "replay.h"
+#include <cstdint>
+#include <string>
+
+// A game in progress, frozen between two ticks. The recording carries the
+// board (size, seed, level) and every turn so far, so a resumed game still
+// verifies and replays as one; the engine state is what the next tick starts
+// from.
+struct Snapshot {
+    Replay recording;
+    uint32_t tick = 0;      // ticks already played
+    EngineState state;
+};
+
+// Binary form: "SNKS", a version byte, the recording in its own encoding,
+// then the engine state as varints, pending timers included. The body is its
+// tail cell followed by one 2-bit step per segment, packed four to a byte, so
+// a 3000-cell snake takes about 750 bytes. The free cells follow as bit-packed grid indices in
+// sampling order, which is what keeps food and bombs landing where they
+// would have without the save.
+std::string encodeSnapshot(const Snapshot& snapshot);
+bool decodeSnapshot(const char* data, size_t size, Snapshot& snapshot);
+
+#endif // SNAPSHOT_H
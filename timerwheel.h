@@ -0,0 +1,251 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Handle to a scheduled timer. Stays safe to use after the timer fired or
+// was cancelled: the slot it names is then reused under a new generation.
+struct TimerId {
+    int slot = -1;
+    uint32_t generation = 0;
+
+    bool valid() const { return slot >= 0; }
+};
+
+// Hierarchical timing wheel over an integer clock (the game runs it in
+// milliseconds). Four levels of 64 slots reach 2^24 units ahead; timers
+// further out wait in an overflow list until their block comes round, and
+// each level's slot is cascaded one level down as the clock enters it.
+// schedule() and cancel() are O(1). advance() visits only occupied slots of
+// the lowest level, plus one cascade per 64 units crossed, however many
+// timers are pending. Timers due at the same time fire in the order they
+// were scheduled, so whatever they drive stays deterministic.
+template <typename T>
+class TimerWheel
+{
+public:
+    static const int SlotBits = 6;
+    static const int Slots = 1 << SlotBits;
+    static const int Levels = 4;
+
+    TimerWheel() { reset(); }
+
+    // Room for count timers pending at once, so scheduling and firing them
+    // never allocates; reset() keeps it
+    void reserve(size_t count) {
+        nodes.reserve(count);
+        firing.reserve(count);
+    }
+
+    // Drops every timer; the clock starts at now
+    void reset(int64_t now = 0) {
+        nodes.clear();
+        freeList = -1;
+        std::fill(std::begin(heads), std::end(heads), -1);
+        nearSlots = 0;
+        current = now;
+        live = 0;
+        nextSeq = 0;
+    }
+
+    // Due times already past fire on the next advance, after the ones that
+    // were due earlier
+    TimerId schedule(int64_t due, const T& value) {
+        int i = freeList;
+        if (i >= 0) {
+            freeList = nodes[i].next;
+        }
+        else {
+            i = static_cast<int>(nodes.size());
+            nodes.emplace_back();
+        }
+        Node& node = nodes[i];
+        node.value = value;
+        node.due = std::max(due, current);
+        node.seq = nextSeq++;
+        place(i);
+        ++live;
+        return { i, node.generation };
+    }
+
+    bool cancel(TimerId id) {
+        if (!pending(id))
+            return false;
+        unlink(id.slot);
+        release(id.slot);
+        return true;
+    }
+
+    bool pending(TimerId id) const {
+        return id.slot >= 0 && id.slot < static_cast<int>(nodes.size()) && nodes[id.slot].list >= 0
+            && nodes[id.slot].generation == id.generation;
+    }
+
+    // Calls fire(due, value) for every timer due at or before now, earliest
+    // first. fire may schedule and cancel; a timer it schedules at or before
+    // now fires within this same call.
+    template <typename Fire>
+    void advance(int64_t now, Fire&& fire) {
+        while (current <= now) {
+            if (live == 0) {
+                current = now + 1;
+                break;
+            }
+            if ((current & (Slots - 1)) == 0)
+                cascade();
+
+            const int slot = static_cast<int>(current & (Slots - 1));
+            while (heads[slot] >= 0) {
+                firing.clear();
+                for (int i = heads[slot]; i >= 0; i = nodes[i].next)
+                    firing.push_back({ nodes[i].seq, i });
+                std::sort(firing.begin(), firing.end());
+                for (const auto& entry : firing) {
+                    // An earlier callback may have cancelled this one
+                    const int i = entry.second;
+                    if (nodes[i].list != slot || nodes[i].seq != entry.first)
+                        continue;
+                    const T value = nodes[i].value;
+                    const int64_t due = nodes[i].due;
+                    unlink(i);
+                    release(i);
+                    fire(due, value);
+                }
+            }
+
+            // On to the next occupied slot of this block, or the next block
+            const uint64_t ahead = nearSlots & ~((uint64_t(2) << slot) - 1);
+            const int64_t next = ahead ? (current & ~int64_t(Slots - 1)) + lowestBit(ahead)
+                                       : (current | (Slots - 1)) + 1;
+            current = std::min(next, now + 1);
+        }
+    }
+
+    // Every pending timer as (due, value), in the order they would fire
+    std::vector<std::pair<int64_t, T>> pendingTimers() const {
+        std::vector<std::pair<uint64_t, int>> order;
+        order.reserve(live);
+        for (int i = 0; i < static_cast<int>(nodes.size()); ++i) {
+            if (nodes[i].list >= 0)
+                order.push_back({ nodes[i].seq, i });
+        }
+        std::sort(order.begin(), order.end(), [this](const std::pair<uint64_t, int>& a, const std::pair<uint64_t, int>& b) {
+            return nodes[a.second].due != nodes[b.second].due ? nodes[a.second].due < nodes[b.second].due
+                                                              : a.first < b.first;
+        });
+        std::vector<std::pair<int64_t, T>> out;
+        out.reserve(order.size());
+        for (const auto& entry : order)
+            out.push_back({ nodes[entry.second].due, nodes[entry.second].value });
+        return out;
+    }
+
+    int64_t now() const { return current; } // the next time advance() will look at
+    size_t size() const { return live; }
+
+private:
+    static const int Overflow = Levels * Slots;
+
+    struct Node {
+        T value = T();
+        int64_t due = 0;
+        uint64_t seq = 0;
+        uint32_t generation = 0;
+        int list = -1;      // heads[] index it is linked into, -1 when free
+        int prev = -1;
+        int next = -1;      // also links the free list
+    };
+
+    static int lowestBit(uint64_t bits) {
+#if defined(__GNUC__)
+        return __builtin_ctzll(bits);
+#else
+        int bit = 0;
+        while (!(bits & 1)) {
+            bits >>= 1;
+            ++bit;
+        }
+        return bit;
+#endif
+    }
+
+    // The lowest level whose block holds both now and the due time; due is
+    // never behind current
+    void place(int i) {
+        const int64_t due = nodes[i].due;
+        for (int level = 0; level < Levels; ++level) {
+            const int shift = SlotBits * (level + 1);
+            if ((due >> shift) == (current >> shift)) {
+                link(i, level * Slots + static_cast<int>((due >> (SlotBits * level)) & (Slots - 1)));
+                return;
+            }
+        }
+        link(i, Overflow);
+    }
+
+    // current starts a new level-0 block: bring down whatever is due in it,
+    // highest level first so each cascade can feed the one below
+    void cascade() {
+        for (int level = Levels; level >= 1; --level) {
+            if (current & ((int64_t(1) << (SlotBits * level)) - 1))
+                continue;
+            const int list = level == Levels
+                ? Overflow
+                : level * Slots + static_cast<int>((current >> (SlotBits * level)) & (Slots - 1));
+            int i = heads[list];
+            heads[list] = -1;
+            while (i >= 0) {
+                const int next = nodes[i].next;
+                place(i);
+                i = next;
+            }
+        }
+    }
+
+    void link(int i, int list) {
+        Node& node = nodes[i];
+        node.list = list;
+        node.prev = -1;
+        node.next = heads[list];
+        if (node.next >= 0)
+            nodes[node.next].prev = i;
+        heads[list] = i;
+        if (list < Slots)
+            nearSlots |= uint64_t(1) << list;
+    }
+
+    void unlink(int i) {
+        Node& node = nodes[i];
+        if (node.prev >= 0)
+            nodes[node.prev].next = node.next;
+        else
+            heads[node.list] = node.next;
+        if (node.next >= 0)
+            nodes[node.next].prev = node.prev;
+        if (node.list < Slots && heads[node.list] < 0)
+            nearSlots &= ~(uint64_t(1) << node.list);
+        node.list = -1;
+    }
+
+    void release(int i) {
+        Node& node = nodes[i];
+        ++node.generation;
+        node.next = freeList;
+        freeList = i;
+        --live;
+    }
+
+    std::vector<Node> nodes;
+    int freeList = -1;
+    int heads[Overflow + 1];
+    uint64_t nearSlots = 0;  // level-0 slots holding a timer, one bit each
+    int64_t current = 0;
+    size_t live = 0;
+    uint64_t nextSeq = 0;
+    std::vector<std::pair<uint64_t, int>> firing;
+};
+
+#endif // TIMERWHEEL_H
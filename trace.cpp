@@ -0,0 +1,115 @@
+#include "trace.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+namespace Trace {
+
+#ifdef SNAKE_TRACING
+
+namespace {
+
+const uint64_t Capacity = 1 << 16; // about a minute of a busy game
+
+// seq is 2 * (write number) + 1 while the slot is being filled and
+// 2 * (write number) + 2 once it is complete, so readers can tell a torn or
+// recycled slot from a finished one
+struct Slot {
+    std::atomic<uint64_t> seq{ 0 };
+    std::atomic<const char*> name{ nullptr };
+    std::atomic<int64_t> startNs{ 0 };
+    std::atomic<int64_t> durationNs{ 0 };
+    std::atomic<uint32_t> thread{ 0 };
+};
+
+Slot ring[Capacity];
+std::atomic<uint64_t> written{ 0 };
+std::atomic<uint32_t> threads{ 0 };
+const auto epoch = std::chrono::steady_clock::now();
+
+uint32_t threadNumber() {
+    thread_local const uint32_t number = threads.fetch_add(1, std::memory_order_relaxed);
+    return number;
+}
+
+} // namespace
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void record(const char* name, int64_t startNs, int64_t endNs) {
+    const uint64_t n = written.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = ring[n % Capacity];
+    slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.startNs.store(startNs, std::memory_order_relaxed);
+    slot.durationNs.store(endNs - startNs, std::memory_order_relaxed);
+    slot.thread.store(threadNumber(), std::memory_order_relaxed);
+    slot.seq.store(2 * n + 2, std::memory_order_release);
+}
+
+void snapshot(std::vector<Event>& events) {
+    events.clear();
+    const uint64_t end = written.load(std::memory_order_acquire);
+    const uint64_t begin = end > Capacity ? end - Capacity : 0;
+    events.reserve(static_cast<size_t>(end - begin));
+    for (uint64_t n = begin; n < end; ++n) {
+        const Slot& slot = ring[n % Capacity];
+        if (slot.seq.load(std::memory_order_acquire) != 2 * n + 2)
+            continue;
+        const Event event = { slot.name.load(std::memory_order_relaxed), slot.startNs.load(std::memory_order_relaxed),
+                              slot.durationNs.load(std::memory_order_relaxed), slot.thread.load(std::memory_order_relaxed) };
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == 2 * n + 2)
+            events.push_back(event);
+    }
+}
+
+#else
+
+int64_t nowNs() {
+    return 0;
+}
+
+void record(const char*, int64_t, int64_t) {}
+
+void snapshot(std::vector<Event>& events) {
+    events.clear();
+}
+
+#endif
+
+// Complete ("X") events with microsecond timestamps, one process
+std::string chromeJson() {
+    std::vector<Event> events;
+    snapshot(events);
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    char line[256];
+    for (size_t i = 0; i < events.size(); ++i) {
+        const Event& e = events[i];
+        std::string name;
+        for (const char* c = e.name; c && *c; ++c) {
+            if (*c == '"' || *c == '\\')
+                name += '\\';
+            name += *c;
+        }
+        std::snprintf(line, sizeof(line), "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                      i ? "," : "", name.c_str(), e.thread, e.startNs / 1e3, e.durationNs / 1e3);
+        json += line;
+    }
+    json += "\n]}\n";
+    return json;
+}
+
+bool writeChromeJson(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    const std::string json = chromeJson();
+    const bool ok = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+} // namespace Trace
@@ -0,0 +1,66 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Scoped timers for the hot path. TRACE_SCOPE("name") records how long the
+// rest of the enclosing block takes into a fixed ring of the most recent
+// spans, which can be exported as Chrome / Perfetto trace JSON (load it in
+// chrome://tracing or ui.perfetto.dev). Writers never lock: each claims a
+// slot with one atomic increment and publishes it with a sequence number.
+//
+// Tracing is only compiled in with SNAKE_TRACING (qmake CONFIG+=tracing).
+// Without it the macro expands to nothing, no buffer exists, and the
+// functions below return empty results.
+namespace Trace {
+
+#ifdef SNAKE_TRACING
+constexpr bool Enabled = true;
+#else
+constexpr bool Enabled = false;
+#endif
+
+struct Event {
+    const char* name;      // string literal, never copied
+    int64_t startNs;       // since the process started
+    int64_t durationNs;
+    uint32_t thread;       // small per-thread number, in order of first use
+};
+
+int64_t nowNs();
+void record(const char* name, int64_t startNs, int64_t endNs);
+
+// The spans still in the ring, oldest first. Spans being written while this
+// runs are skipped.
+void snapshot(std::vector<Event>& events);
+
+std::string chromeJson();
+bool writeChromeJson(const std::string& path);
+
+class Scope
+{
+public:
+    explicit Scope(const char* name) : label(name), start(nowNs()) {}
+    ~Scope() { record(label, start, nowNs()); }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* label;
+    int64_t start;
+};
+
+} // namespace Trace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef SNAKE_TRACING
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,78 @@
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// LEB128 varints and length-prefixed strings, shared by the replay and
+// snapshot formats
+
+inline void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+// Signed values, zigzag-encoded so small negatives stay one byte
+inline void putSigned(std::string& out, int64_t value) {
+    putVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+inline void putString(std::string& out, const std::string& text) {
+    putVarint(out, text.size());
+    out += text;
+}
+
+// Reads from [p, end); any overrun clears ok and yields zeros from then on
+struct VarintReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p >= end) {
+                ok = false;
+                return 0;
+            }
+            const uint8_t byte = *p++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+        ok = false;
+        return 0;
+    }
+
+    int64_t signedVarint() {
+        const uint64_t value = varint();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    std::string string() {
+        const uint64_t size = varint();
+        if (!ok || size > static_cast<uint64_t>(end - p)) {
+            ok = false;
+            return std::string();
+        }
+        std::string text(reinterpret_cast<const char*>(p), static_cast<size_t>(size));
+        p += size;
+        return text;
+    }
+
+    bool bytes(void* out, size_t size) {
+        if (!ok || size > static_cast<size_t>(end - p)) {
+            ok = false;
+            return false;
+        }
+        std::memcpy(out, p, size);
+        p += size;
+        return true;
+    }
+};
+
+#endif // VARINT_H
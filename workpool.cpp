@@ -0,0 +1,60 @@
+#include "workpool.h"
+#include <algorithm>
+#include <thread>
+
+WorkStealingPool::WorkStealingPool(int threads) {
+    if (threads <= 0)
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    workers = std::max(1, threads);
+    for (int i = 0; i < workers; ++i)
+        queues.push_back(std::make_unique<Queue>());
+}
+
+void WorkStealingPool::run(size_t jobs, const std::function<void(size_t job, int worker)>& task) {
+    for (int i = 0; i < workers; ++i) {
+        Queue& queue = *queues[i];
+        const size_t first = jobs * i / workers;
+        const size_t last = jobs * (i + 1) / workers;
+        queue.jobs.clear();
+        for (size_t job = first; job < last; ++job)
+            queue.jobs.push_back(job);
+    }
+
+    auto work = [this, &task](int worker) {
+        size_t job;
+        while (take(worker, job))
+            task(job, worker);
+    };
+
+    // The calling thread is worker 0
+    std::vector<std::thread> threads;
+    for (int i = 1; i < workers; ++i)
+        threads.emplace_back(work, i);
+    work(0);
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+// Nothing is queued once run() starts, so finding every queue empty means
+// the batch is done
+bool WorkStealingPool::take(int worker, size_t& job) {
+    {
+        Queue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = own.jobs.back();
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+    for (int i = 1; i < workers; ++i) {
+        Queue& victim = *queues[(worker + i) % workers];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = victim.jobs.front();
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,40 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Runs a batch of independent jobs on every core. Each worker starts with
+// its own contiguous block of job indices and works through it from the
+// back; a worker that runs dry steals from the front of another's block, so
+// uneven jobs (a long game next to a short one) still keep all cores busy.
+// Jobs are coarse, so a plain mutex per queue is never contended for long.
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(int threads = 0); // 0 = one per hardware thread
+
+    int threadCount() const { return workers; }
+
+    // Calls task(job, worker) for every job in [0, jobs); returns when all
+    // are done. worker is in [0, threadCount()) and identifies the calling
+    // thread, for per-worker scratch state.
+    void run(size_t jobs, const std::function<void(size_t job, int worker)>& task);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> jobs;
+    };
+
+    bool take(int worker, size_t& job);
+
+    int workers = 1;
+    std::vector<std::unique_ptr<Queue>> queues;
+};
+
+#endif // WORKPOOL_H